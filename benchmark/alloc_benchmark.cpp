@@ -0,0 +1,141 @@
+#include <benchmark/benchmark.h>
+#include <pformat/pformat.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// counts the heap allocations of the benchmark binary
+static std::atomic<size_t> allocation_count{0};
+
+// The replacements are kept out of line. Inlined, GCC sees malloc() and
+// free() paired with operator new and delete and warns
+// (-Wmismatched-new-delete).
+__attribute__((noinline)) void *operator new(size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void *operator new[](size_t size) {
+    return operator new(size);
+}
+
+__attribute__((noinline)) void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete(void *p, size_t) noexcept {
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete[](void *p) noexcept {
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete[](void *p, size_t) noexcept {
+    std::free(p);
+}
+
+template <typename format_func_t>
+static void run_counting_allocations(benchmark::State &state,
+                                     format_func_t &&format_func) {
+    size_t allocations = 0;
+    for (auto _ : state) {
+        auto before = allocation_count.load(std::memory_order_relaxed);
+        auto s = format_func();
+        benchmark::DoNotOptimize(s);
+        allocations += allocation_count.load(std::memory_order_relaxed) - before;
+    }
+    state.counters["allocs"] = benchmark::Counter(
+        allocations, benchmark::Counter::kAvgIterations);
+}
+
+static char const *const s = "text";
+
+static void BM_PFormatStringShort(benchmark::State &state) {
+    using namespace pformat;
+    constexpr auto compiled_format = "{}:{} {}"_fmt;
+    int i = 17;
+    run_counting_allocations(
+        state, [&]() { return compiled_format.format(i, 2, s); });
+}
+BENCHMARK(BM_PFormatStringShort);
+
+static void BM_PFormatStringMedium(benchmark::State &state) {
+    using namespace pformat;
+    constexpr auto compiled_format = "foo {} bar {} do {}"_fmt;
+    int i = 17;
+    run_counting_allocations(
+        state, [&]() { return compiled_format.format(i, 2, s); });
+}
+BENCHMARK(BM_PFormatStringMedium);
+
+static void BM_PFormatStringDouble(benchmark::State &state) {
+    using namespace pformat;
+    constexpr auto compiled_format = "foo {} bar {}"_fmt;
+    double d = 1.5;
+    run_counting_allocations(
+        state, [&]() { return compiled_format.format(d, s); });
+}
+BENCHMARK(BM_PFormatStringDouble);
+
+static void BM_PFormatStringLong(benchmark::State &state) {
+    using namespace pformat;
+    constexpr auto compiled_format = "foo {} bar {} do {}"_fmt;
+    std::string long_str(state.range(0), 'a');
+    int i = 17;
+    run_counting_allocations(state, [&]() {
+        return compiled_format.format(i, long_str, long_str.c_str());
+    });
+}
+BENCHMARK(BM_PFormatStringLong)->Range(1 << 6, 1 << 12);
+
+// appends 16 messages per iteration to a buffer, which is reused
+static void BM_PFormatAppendMemoryBuffer(benchmark::State &state) {
+    using namespace pformat;
+    constexpr auto compiled_format = "foo {} bar {} do {}\n"_fmt;
+    int i = 17;
+    memory_buffer buffer;
+    run_counting_allocations(state, [&]() {
+        buffer.clear();
+        for (int n = 0; n < 16; ++n) {
+            compiled_format.format_append(buffer, i, n, s);
+        }
+        return buffer.size();
+    });
+}
+BENCHMARK(BM_PFormatAppendMemoryBuffer);
+
+static void BM_PFormatAppendString(benchmark::State &state) {
+    using namespace pformat;
+    constexpr auto compiled_format = "foo {} bar {} do {}\n"_fmt;
+    int i = 17;
+    std::string buffer;
+    run_counting_allocations(state, [&]() {
+        buffer.clear();
+        for (int n = 0; n < 16; ++n) {
+            compiled_format.format_append(buffer, i, n, s);
+        }
+        return buffer.size();
+    });
+}
+BENCHMARK(BM_PFormatAppendString);
+
+// the same 16 messages with one string per message
+static void BM_PFormatConcatStrings(benchmark::State &state) {
+    using namespace pformat;
+    constexpr auto compiled_format = "foo {} bar {} do {}\n"_fmt;
+    int i = 17;
+    std::string buffer;
+    run_counting_allocations(state, [&]() {
+        buffer.clear();
+        for (int n = 0; n < 16; ++n) {
+            buffer += compiled_format.format(i, n, s);
+        }
+        return buffer.size();
+    });
+}
+BENCHMARK(BM_PFormatConcatStrings);
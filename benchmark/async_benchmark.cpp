@@ -0,0 +1,90 @@
+#include <benchmark/benchmark.h>
+#include <pformat/async.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+static char const *const s = "text";
+
+// per-call latency percentiles of the calling thread
+template <typename write_func_t>
+static void run_measuring_latency(benchmark::State &state,
+                                  write_func_t &&write_func) {
+    using clock = std::chrono::steady_clock;
+    std::vector<int64_t> latencies;
+    latencies.reserve(1 << 20);
+    long i = 0;
+    for (auto _ : state) {
+        auto start = clock::now();
+        write_func(i++);
+        auto end = clock::now();
+        if (latencies.size() < latencies.capacity()) {
+            latencies.push_back(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(end -
+                                                                     start)
+                    .count());
+        }
+    }
+    std::sort(latencies.begin(), latencies.end());
+    if (!latencies.empty()) {
+        state.counters["p50_ns"] = benchmark::Counter(
+            latencies[latencies.size() / 2], benchmark::Counter::kAvgThreads);
+        state.counters["p99_ns"] =
+            benchmark::Counter(latencies[latencies.size() * 99 / 100],
+                               benchmark::Counter::kAvgThreads);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+static std::unique_ptr<pformat::async_writer> writer;
+
+static void BM_PFormatAsync(benchmark::State &state) {
+    using namespace pformat;
+    if (state.thread_index() == 0) {
+        async_options options;
+        options.policy = static_cast<backpressure>(state.range(0));
+        writer = std::make_unique<async_writer>(
+            [](char const *data, size_t size) {
+                benchmark::DoNotOptimize(data);
+                benchmark::DoNotOptimize(size);
+            },
+            options);
+    }
+    constexpr auto compiled_format = "foo {} bar {} do {}"_fmt;
+    run_measuring_latency(
+        state, [&](long i) { writer->write(compiled_format, i, 2, s); });
+    if (state.thread_index() == 0) {
+        state.counters["dropped"] = writer->stats().dropped;
+        writer.reset();
+    }
+}
+BENCHMARK(BM_PFormatAsync)
+    ->Arg(static_cast<int>(pformat::backpressure::BLOCK))
+    ->Arg(static_cast<int>(pformat::backpressure::DROP))
+    ->ThreadRange(1, 4)
+    ->UseRealTime();
+
+// baseline: every thread formats synchronously into a shared block
+static std::mutex sync_mutex;
+static std::vector<char> sync_block(1 << 20);
+static size_t sync_used = 0;
+
+static void BM_PFormatSync(benchmark::State &state) {
+    using namespace pformat;
+    constexpr auto compiled_format = "foo {} bar {} do {}"_fmt;
+    run_measuring_latency(state, [&](long i) {
+        std::lock_guard<std::mutex> lock(sync_mutex);
+        if (sync_block.size() - sync_used < 100) {
+            benchmark::DoNotOptimize(sync_block.data());
+            sync_used = 0;
+        }
+        char *end =
+            compiled_format.format_to(sync_block.data() + sync_used, i, 2, s);
+        *end++ = '\n';
+        sync_used = end - sync_block.data();
+    });
+}
+BENCHMARK(BM_PFormatSync)->ThreadRange(1, 4)->UseRealTime();
@@ -0,0 +1,110 @@
+#!/usr/bin/env python3
+"""Compares two JSON outputs of pformat_benchmark.
+
+usage: compare.py [--threshold 0.1] [--min-delta 1] [--filter regex]
+                  baseline current
+       compare.py --update baseline current
+
+Prints the cpu time of every case in both files and exits with 1 if a
+case of the current run is slower than the baseline by more than the
+threshold (relative) and by more than min-delta nanoseconds, which keeps
+the noise of sub-nanosecond cases out, or if a case of the baseline is
+missing in the current run. Cases run with --benchmark_repetitions are
+compared by their median. A missing baseline file exits with 2.
+
+--update writes the cases of the current run as the new baseline.
+"""
+
+import argparse
+import json
+import os
+import re
+import sys
+
+TIME_UNITS = {"ns": 1.0, "us": 1e3, "ms": 1e6, "s": 1e9}
+
+
+def load_times(path):
+    """returns {case name: cpu time in ns} of a benchmark JSON file"""
+    with open(path) as f:
+        benchmarks = json.load(f)["benchmarks"]
+    medians = {}
+    iterations = {}
+    for b in benchmarks:
+        time = b["cpu_time"] * TIME_UNITS[b.get("time_unit", "ns")]
+        if b.get("run_type") == "aggregate":
+            if b.get("aggregate_name") == "median":
+                medians[b["run_name"]] = time
+        else:
+            name = b.get("run_name", b["name"])
+            iterations[name] = min(time, iterations.get(name, time))
+    return medians if medians else iterations
+
+
+def write_baseline(path, times):
+    benchmarks = [{"name": name, "cpu_time": time, "time_unit": "ns"}
+                  for name, time in sorted(times.items())]
+    with open(path, "w") as f:
+        json.dump({"benchmarks": benchmarks}, f, indent=1)
+        f.write("\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Compares two JSON outputs of pformat_benchmark.")
+    parser.add_argument("--threshold", type=float, default=0.1,
+                        help="relative slowdown that fails a case")
+    parser.add_argument("--min-delta", type=float, default=1.0,
+                        help="slowdown in ns a failing case needs at least")
+    parser.add_argument("--filter", default="",
+                        help="only compare cases matching the regex")
+    parser.add_argument("--update", action="store_true",
+                        help="write the current run as the baseline")
+    parser.add_argument("baseline")
+    parser.add_argument("current")
+    args = parser.parse_args()
+
+    current = load_times(args.current)
+    current = {name: time for name, time in current.items()
+               if re.search(args.filter, name)}
+    if args.update:
+        write_baseline(args.baseline, current)
+        print("wrote {} cases to {}".format(len(current), args.baseline))
+        return 0
+
+    if not os.path.exists(args.baseline):
+        print("no baseline {}, record one with the benchmark_baseline target "
+              "or --update".format(args.baseline))
+        return 2
+    baseline = load_times(args.baseline)
+    regressions = 0
+    width = max([len(name) for name in current] + [4])
+    print("{:<{}} {:>12} {:>12} {:>8}".format("case", width, "baseline",
+                                              "current", "change"))
+    for name, time in sorted(current.items()):
+        if name not in baseline:
+            print("{:<{}} {:>12} {:>10.2f}ns {:>8}".format(
+                name, width, "-", time, "new"))
+            continue
+        change = time / baseline[name] - 1
+        regressed = (change > args.threshold and
+                     time - baseline[name] > args.min_delta)
+        regressions += regressed
+        print("{:<{}} {:>10.2f}ns {:>10.2f}ns {:>+7.1%}{}".format(
+            name, width, baseline[name], time, change,
+            " REGRESSION" if regressed else ""))
+    missing = [name for name in sorted(set(baseline) - set(current))
+               if re.search(args.filter, name)]
+    for name in missing:
+        print("{:<{}} missing in the current run".format(name, width))
+
+    if regressions > 0:
+        print("{} cases regressed by more than {:.0%}".format(
+            regressions, args.threshold))
+    if missing:
+        print("{} cases of the baseline are missing".format(len(missing)))
+    return 1 if regressions > 0 or missing else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,164 @@
+// Measures the compile time and memory of pformat format sites.
+//
+// Generates N translation units with M _fmt sites each, compiles them
+// one after another and reports the wall time and the peak memory
+// (maximal resident set size) of the compiler.
+//
+// usage: pformat_compile_benchmark [--compiler c++] [--include dir]
+//            [--tus N] [--sites M] [--flags "-O2"] [--dir output-dir]
+
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct options {
+    std::string compiler = "c++";
+    std::string include = "include";
+    std::string flags = "-O2";
+    std::string dir = "compile_benchmark";
+    int tus = 8;
+    int sites = 200;
+};
+
+struct compile_result {
+    double seconds;
+    long max_rss_kb;
+};
+
+// the literal text of site i. Every 8th site is longer than 200
+// characters.
+std::string site_text(int tu, int i) {
+    std::ostringstream s;
+    s << "tu " << tu << " site " << i << " value {} ";
+    for (int j = 0; j < i % 8; ++j) {
+        s << "some longer literal text with a {:08x} ";
+    }
+    s << "done {:>10} ratio {:.3f}";
+    return s.str();
+}
+
+void generate(options const &o, int tu, std::string const &path) {
+    std::ofstream out(path);
+    out << "#include <pformat/pformat.h>\n\n"
+           "#include <cstdint>\n#include <string>\n\n"
+           "using namespace pformat;\n\n";
+    for (int i = 0; i < o.sites; ++i) {
+        out << "std::string site_" << tu << "_" << i
+            << "(int a, uint32_t b, char const *c, double d) {\n"
+            << "    return \"" << site_text(tu, i) << "\"_fmt.format(a";
+        for (int j = 0; j < i % 8; ++j) {
+            out << ", b";
+        }
+        out << ", c, d);\n}\n\n";
+    }
+}
+
+double now_seconds() {
+    return std::chrono::duration<double>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+bool compile(options const &o, std::string const &source,
+             std::string const &object, compile_result &result) {
+    std::vector<std::string> args{o.compiler, "-std=c++17", "-c",
+                                  "-I" + o.include};
+    std::istringstream flags(o.flags);
+    for (std::string flag; flags >> flag;) {
+        args.push_back(flag);
+    }
+    args.push_back(source);
+    args.push_back("-o");
+    args.push_back(object);
+
+    std::vector<char *> argv;
+    for (auto &a : args) {
+        argv.push_back(a.data());
+    }
+    argv.push_back(nullptr);
+
+    double const start = now_seconds();
+    pid_t const pid = ::fork();
+    if (pid < 0) {
+        std::perror("fork");
+        return false;
+    }
+    if (pid == 0) {
+        ::execvp(argv[0], argv.data());
+        std::perror(argv[0]);
+        std::_Exit(127);
+    }
+    int status;
+    struct rusage usage;
+    if (::wait4(pid, &status, 0, &usage) != pid) {
+        std::perror("wait4");
+        return false;
+    }
+    result.seconds = now_seconds() - start;
+    result.max_rss_kb = usage.ru_maxrss;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    options o;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string const name = argv[i];
+        char const *value = argv[i + 1];
+        if (name == "--compiler") {
+            o.compiler = value;
+        } else if (name == "--include") {
+            o.include = value;
+        } else if (name == "--flags") {
+            o.flags = value;
+        } else if (name == "--dir") {
+            o.dir = value;
+        } else if (name == "--tus") {
+            o.tus = std::max(1, std::atoi(value));
+        } else if (name == "--sites") {
+            o.sites = std::max(1, std::atoi(value));
+        } else {
+            std::fprintf(stderr, "unknown option %s\n", name.c_str());
+            return 2;
+        }
+    }
+    if (std::system(("mkdir -p '" + o.dir + "'").c_str()) != 0) {
+        return 1;
+    }
+
+    std::printf("%d translation units with %d format sites each\n", o.tus,
+                o.sites);
+    double total = 0;
+    long max_rss_kb = 0;
+    for (int tu = 0; tu < o.tus; ++tu) {
+        std::string const base = o.dir + "/sites_" + std::to_string(tu);
+        generate(o, tu, base + ".cpp");
+        compile_result r;
+        if (!compile(o, base + ".cpp", base + ".o", r)) {
+            std::fprintf(stderr, "compiling %s.cpp failed\n", base.c_str());
+            return 1;
+        }
+        std::printf("  %s.cpp: %.2f s, %ld MiB\n", base.c_str(), r.seconds,
+                    r.max_rss_kb / 1024);
+        total += r.seconds;
+        max_rss_kb = std::max(max_rss_kb, r.max_rss_kb);
+    }
+    std::printf("total %.2f s, %.2f s per translation unit, %.2f ms per site\n",
+                total, total / o.tus, 1000 * total / (o.tus * o.sites));
+    std::printf("peak memory %ld MiB\n", max_rss_kb / 1024);
+    return 0;
+}
@@ -0,0 +1,38 @@
+#include <benchmark/benchmark.h>
+#include <fcntl.h>
+#include <pformat/export.h>
+#include <unistd.h>
+
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+// CSV export of 1M rows to /dev/null, the argument is the number of
+// formatting threads
+static void BM_ExportRows(benchmark::State &state) {
+    using namespace pformat;
+    using row_t = std::tuple<uint64_t, uint32_t, double, std::string>;
+    std::mt19937_64 rnd(42);
+    std::vector<row_t> rows;
+    for (size_t i = 0; i < (1 << 20); ++i) {
+        rows.emplace_back(rnd(), static_cast<uint32_t>(rnd() % 100000),
+                          (rnd() % 100000) / 100.0,
+                          std::string(rnd() % 16, 'a'));
+    }
+    int const fd = ::open("/dev/null", O_WRONLY);
+    export_options options;
+    options.threads = state.range(0);
+    for (auto _ : state) {
+        auto result = export_rows(fd, "{},{},{:.2f},{}\n"_fmt, rows, options);
+        benchmark::DoNotOptimize(result);
+    }
+    ::close(fd);
+    state.SetItemsProcessed(state.iterations() * rows.size());
+}
+BENCHMARK(BM_ExportRows)
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(4)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
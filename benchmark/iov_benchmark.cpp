@@ -0,0 +1,40 @@
+#include <benchmark/benchmark.h>
+#include <fcntl.h>
+#include <pformat/pformat.h>
+#include <unistd.h>
+
+#include <string>
+
+// a log line with a large payload written to /dev/null, the argument is
+// the payload size
+
+static void BM_PFormatAppendWrite(benchmark::State &state) {
+    using namespace pformat;
+    std::string const payload(state.range(0), 'p');
+    int const fd = ::open("/dev/null", O_WRONLY);
+    memory_buffer buffer;
+    for (auto _ : state) {
+        buffer.clear();
+        "request id={} status={} body={}\n"_fmt.format_append(buffer, 4711,
+                                                               200, payload);
+        benchmark::DoNotOptimize(::write(fd, buffer.data(), buffer.size()));
+    }
+    ::close(fd);
+    state.SetBytesProcessed(state.iterations() * payload.size());
+}
+BENCHMARK(BM_PFormatAppendWrite)->Range(1 << 6, 1 << 16);
+
+static void BM_PFormatIovWritev(benchmark::State &state) {
+    using namespace pformat;
+    std::string const payload(state.range(0), 'p');
+    int const fd = ::open("/dev/null", O_WRONLY);
+    iov_builder out;
+    for (auto _ : state) {
+        "request id={} status={} body={}\n"_fmt.format_iov(out, 4711, 200,
+                                                            payload);
+        benchmark::DoNotOptimize(out.write_to(fd));
+    }
+    ::close(fd);
+    state.SetBytesProcessed(state.iterations() * payload.size());
+}
+BENCHMARK(BM_PFormatIovWritev)->Range(1 << 6, 1 << 16);
@@ -0,0 +1,154 @@
+// Benchmark matrix for regression tracking, see benchmark/compare.py and
+// the benchmark_regression target.
+//
+// Every case is named BM_Matrix/<dimension>/<case>/<api>, where api is
+// one of format (std::string), format_to (char buffer) and size_bound
+// (string_size_bound).
+
+#include <benchmark/benchmark.h>
+#include <pformat/pformat.h>
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace {
+
+enum class matrix_enum : int { value = 12345 };
+
+struct api_format {
+    static constexpr char const *name = "format";
+
+    template <typename log_config_t, typename... args_t>
+    static void run(log_config_t const &f, args_t const &... args) {
+        auto s = f.format(args...);
+        benchmark::DoNotOptimize(s.data());
+    }
+};
+
+struct api_format_to {
+    static constexpr char const *name = "format_to";
+
+    template <typename log_config_t, typename... args_t>
+    static void run(log_config_t const &f, args_t const &... args) {
+        static char buf[8192];
+        auto end = f.format_to(buf, args...);
+        benchmark::DoNotOptimize(end);
+        benchmark::ClobberMemory();
+    }
+};
+
+struct api_size_bound {
+    static constexpr char const *name = "size_bound";
+
+    template <typename log_config_t, typename... args_t>
+    static void run(log_config_t const &f, args_t const &... args) {
+        benchmark::DoNotOptimize(f.string_size_bound(args...));
+    }
+};
+
+template <typename api_t, typename log_config_t, typename... args_t>
+void run_case(benchmark::State &state, log_config_t const &f,
+              args_t... args) {
+    for (auto _ : state) {
+        // the escaped addresses keep the arguments from being folded in
+        (benchmark::DoNotOptimize(&args), ...);
+        api_t::run(f, args...);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// registers the case for all apis
+template <typename func_t>
+void register_case(std::string const &name, func_t func) {
+    auto add = [&](auto api) {
+        using api_t = decltype(api);
+        benchmark::RegisterBenchmark(
+            ("BM_Matrix/" + name + "/" + api_t::name).c_str(),
+            [func](benchmark::State &state) { func(api_t{}, state); });
+    };
+    add(api_format{});
+    add(api_format_to{});
+    add(api_size_bound{});
+}
+
+// one argument of each type, surrounded by a few literals
+template <typename value_t>
+void register_type(std::string const &name, value_t value) {
+    register_case(name, [value](auto api, benchmark::State &state) {
+        using namespace pformat;
+        run_case<decltype(api)>(state, "value={} end"_fmt, value);
+    });
+}
+
+// a format string of n "{} " and n int arguments
+template <size_t... i>
+constexpr auto repeated_parameters(std::index_sequence<i...>) {
+    return pformat::operator""_fmt<char, "{} "[i % 3]...>();
+}
+
+template <typename api_t, typename log_config_t, size_t... i>
+void run_count(benchmark::State &state, log_config_t const &f,
+               std::index_sequence<i...>) {
+    run_case<api_t>(state, f, static_cast<int>(i * 1000 + 7)...);
+}
+
+template <size_t n>
+void register_count() {
+    register_case("count/" + std::to_string(n),
+                  [](auto api, benchmark::State &state) {
+                      constexpr auto f = repeated_parameters(
+                          std::make_index_sequence<3 * n>());
+                      run_count<decltype(api)>(state, f,
+                                               std::make_index_sequence<n>());
+                  });
+}
+
+template <size_t... n>
+void register_counts(std::index_sequence<n...>) {
+    (register_count<n>(), ...);
+}
+
+std::string const short_string = "short string";
+std::string const long_string(4096, 'l');
+
+int register_matrix() {
+    register_type("type/int8", int8_t(-100));
+    register_type("type/int16", int16_t(-30000));
+    register_type("type/int32", int32_t(123456789));
+    register_type("type/int64", int64_t(1234567890123456789));
+    register_type("type/int64_min", std::numeric_limits<int64_t>::min());
+    register_type("type/uint64", std::numeric_limits<uint64_t>::max());
+    register_type("type/double", 1234.5678);
+    register_type("type/bool", true);
+    register_type("type/enum", matrix_enum::value);
+    register_type("type/string", short_string);
+    register_type("type/string_view_long", std::string_view(long_string));
+    register_type("type/pointer", pformat::any(&long_string));
+
+    register_counts(std::make_index_sequence<17>());
+
+    // the same four arguments with much literal text or none
+    register_case("shape/literal_heavy", [](auto api,
+                                            benchmark::State &state) {
+        using namespace pformat;
+        run_case<decltype(api)>(
+            state,
+            "component=storage.engine level=INFO segment={} msg=\"segment "
+            "flushed to disk\" pages={} bytes={} duration_us={} done"_fmt,
+            17, 4096, 16777216, 1234);
+    });
+    register_case("shape/parameter_heavy", [](auto api,
+                                              benchmark::State &state) {
+        using namespace pformat;
+        run_case<decltype(api)>(state, "{}{}{}{}"_fmt, 17, 4096, 16777216,
+                                1234);
+    });
+    return 0;
+}
+
+int const registered = register_matrix();
+
+}  // namespace
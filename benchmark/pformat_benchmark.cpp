@@ -1,5 +1,13 @@
 #include <benchmark/benchmark.h>
 #include <pformat/pformat.h>
+#include <pformat/timestamp.h>
+
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <random>
+#include <tuple>
+#include <vector>
 
 static char const * const s = "text";
 
@@ -19,3 +27,428 @@ static void BM_PFormat(benchmark::State &state) {
     }
 }
 BENCHMARK(BM_PFormat)->Range(1, 1 << 4);
+
+template <typename int_t>
+static void BM_PFormatInteger(benchmark::State &state, int_t value) {
+    using namespace pformat;
+    auto n = state.range(0);
+    for (auto _ : state) {
+        constexpr auto compiled_format = "foo {} bar {} do {}"_fmt;
+        for (long i = 0; i < n; ++i) {
+            char buf[100];
+            benchmark::DoNotOptimize(buf);
+            benchmark::DoNotOptimize(value);
+            auto end = compiled_format.format_to(buf, value, value, value);
+            *end = 0;
+            benchmark::ClobberMemory();
+        }
+    }
+}
+BENCHMARK_CAPTURE(BM_PFormatInteger, small, 7)->Range(1, 1 << 4);
+BENCHMARK_CAPTURE(BM_PFormatInteger, medium, 1234567)->Range(1, 1 << 4);
+BENCHMARK_CAPTURE(BM_PFormatInteger, max_uint64,
+                  std::numeric_limits<uint64_t>::max())
+    ->Range(1, 1 << 4);
+BENCHMARK_CAPTURE(BM_PFormatInteger, min_int64,
+                  std::numeric_limits<int64_t>::min())
+    ->Range(1, 1 << 4);
+
+static void BM_PFormatPointer(benchmark::State &state) {
+    using namespace pformat;
+    auto n = state.range(0);
+    for (auto _ : state) {
+        constexpr auto compiled_format = "foo {} bar"_fmt;
+        for (long i = 0; i < n; ++i) {
+            char buf[100];
+            benchmark::DoNotOptimize(buf);
+            auto end = compiled_format.format_to(buf, any(buf));
+            *end = 0;
+            benchmark::ClobberMemory();
+        }
+    }
+}
+BENCHMARK(BM_PFormatPointer)->Range(1, 1 << 4);
+
+static void BM_PFormatDouble(benchmark::State &state) {
+    using namespace pformat;
+    auto n = state.range(0);
+    double value = 1234.5678;
+    for (auto _ : state) {
+        constexpr auto compiled_format = "foo {} bar"_fmt;
+        for (long i = 0; i < n; ++i) {
+            char buf[400];
+            benchmark::DoNotOptimize(buf);
+            benchmark::DoNotOptimize(value);
+            auto end = compiled_format.format_to(buf, value);
+            *end = 0;
+            benchmark::ClobberMemory();
+        }
+    }
+}
+BENCHMARK(BM_PFormatDouble)->Range(1, 1 << 4);
+
+static void BM_PFormatSpecs(benchmark::State &state) {
+    using namespace pformat;
+    auto n = state.range(0);
+    uint32_t id = 0xbeef;
+    int value = 42;
+    double ratio = 1234.5678;
+    for (auto _ : state) {
+        constexpr auto compiled_format =
+            "id {:08x} value {:>6} ratio {:.3f}"_fmt;
+        for (long i = 0; i < n; ++i) {
+            char buf[400];
+            benchmark::DoNotOptimize(buf);
+            benchmark::DoNotOptimize(id);
+            benchmark::DoNotOptimize(value);
+            benchmark::DoNotOptimize(ratio);
+            auto end = compiled_format.format_to(buf, id, value, ratio);
+            *end = 0;
+            benchmark::ClobberMemory();
+        }
+    }
+}
+BENCHMARK(BM_PFormatSpecs)->Range(1, 1 << 4);
+
+static void BM_PFormatLiterals(benchmark::State &state) {
+    using namespace pformat;
+    auto n = state.range(0);
+    int value = 42;
+    for (auto _ : state) {
+        // mostly literal text, split by escapes
+        constexpr auto compiled_format =
+            "component=storage.engine level=INFO {{flush}} segment={} "
+            "msg=\"segment flushed to disk\" {{done}} pages={} bar"_fmt;
+        for (long i = 0; i < n; ++i) {
+            char buf[200];
+            benchmark::DoNotOptimize(buf);
+            benchmark::DoNotOptimize(value);
+            auto end = compiled_format.format_to(buf, value, value);
+            *end = 0;
+            benchmark::ClobberMemory();
+        }
+    }
+}
+BENCHMARK(BM_PFormatLiterals)->Range(1, 1 << 4);
+
+// format_to_n into a fixed size slot: the static size bound fits (no
+// bounds checks), fits only after measuring, or has to be truncated
+static void BM_PFormatToN(benchmark::State &state) {
+    using namespace pformat;
+    auto n = state.range(0);
+    uint32_t id = 0xbeef;
+    std::string name = "storage-engine-flush-worker";
+    for (auto _ : state) {
+        constexpr auto compiled_format = "foo {} bar {:08x} do {}"_fmt;
+        for (long i = 0; i < n; ++i) {
+            char slot[48];
+            benchmark::DoNotOptimize(slot);
+            benchmark::DoNotOptimize(id);
+            auto r1 =
+                compiled_format.format_to_n(slot, sizeof(slot), i, id, 'c');
+            benchmark::DoNotOptimize(r1);
+            auto r2 = compiled_format.format_to_n(slot, sizeof(slot), i, id,
+                                                  name);
+            benchmark::DoNotOptimize(r2);
+            auto r3 = compiled_format.format_to_n(slot, 32, i, id, name);
+            benchmark::DoNotOptimize(r3);
+            benchmark::ClobberMemory();
+        }
+    }
+}
+BENCHMARK(BM_PFormatToN)->Range(1, 1 << 4);
+
+// timestamp in nanoseconds, id and small counter
+using batch_record = std::tuple<uint64_t, uint32_t, int>;
+
+static std::vector<batch_record> make_batch_records(size_t count) {
+    std::mt19937_64 rnd(42);
+    std::vector<batch_record> records;
+    uint64_t timestamp = 1700000000000000000ULL;
+    for (size_t i = 0; i < count; ++i) {
+        timestamp += rnd() % 100000;
+        records.emplace_back(timestamp,
+                             static_cast<uint32_t>(rnd() % 10000000),
+                             static_cast<int>(rnd() % 2000) - 1000);
+    }
+    return records;
+}
+
+// 1024 records formatted one format_append at a time
+static void BM_PFormatBatchPerRecord(benchmark::State &state) {
+    using namespace pformat;
+    auto const records = make_batch_records(1024);
+    memory_buffer buffer;
+    for (auto _ : state) {
+        constexpr auto compiled_format = "ts={} id={} delta={}\n"_fmt;
+        buffer.clear();
+        for (auto const &r : records) {
+            compiled_format.format_append(buffer, std::get<0>(r),
+                                          std::get<1>(r), std::get<2>(r));
+        }
+        benchmark::DoNotOptimize(buffer.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * records.size());
+}
+BENCHMARK(BM_PFormatBatchPerRecord);
+
+// the same records with format_batch
+static void BM_PFormatBatch(benchmark::State &state) {
+    using namespace pformat;
+    auto const records = make_batch_records(1024);
+    memory_buffer buffer;
+    for (auto _ : state) {
+        constexpr auto compiled_format = "ts={} id={} delta={}"_fmt;
+        buffer.clear();
+        compiled_format.format_batch(records, buffer);
+        benchmark::DoNotOptimize(buffer.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * records.size());
+}
+BENCHMARK(BM_PFormatBatch);
+
+static void BM_PFormatDoubleShortest(benchmark::State &state) {
+    using namespace pformat;
+    auto n = state.range(0);
+    double value = 1234.5678;
+    for (auto _ : state) {
+        constexpr auto compiled_format = "foo {} bar"_fmt;
+        for (long i = 0; i < n; ++i) {
+            char buf[100];
+            benchmark::DoNotOptimize(buf);
+            benchmark::DoNotOptimize(value);
+            auto end = compiled_format.format_to(buf, shortest(value));
+            *end = 0;
+            benchmark::ClobberMemory();
+        }
+    }
+}
+BENCHMARK(BM_PFormatDoubleShortest)->Range(1, 1 << 4);
+
+static void BM_PFormatCapture(benchmark::State &state) {
+    using namespace pformat;
+    auto n = state.range(0);
+    for (auto _ : state) {
+        constexpr auto compiled_format = "foo {} bar {} do {}"_fmt;
+        for (long i = 0; i < n; ++i) {
+            char buf[100];
+            benchmark::DoNotOptimize(buf);
+            compiled_format.capture_to(buf, i, 2, s);
+            benchmark::ClobberMemory();
+        }
+    }
+}
+BENCHMARK(BM_PFormatCapture)->Range(1, 1 << 4);
+
+// a 4 KiB page as hex, byte by byte with a spec vs with hexdump
+static std::vector<uint8_t> const page = [] {
+    std::vector<uint8_t> p(4096);
+    std::mt19937 gen(1);
+    for (auto &b : p) {
+        b = static_cast<uint8_t>(gen());
+    }
+    return p;
+}();
+
+static void BM_PFormatHexPerByte(benchmark::State &state) {
+    using namespace pformat;
+    static char buf[2 * 4096 + 1];
+    for (auto _ : state) {
+        char *p = buf;
+        for (uint8_t b : page) {
+            p = "{:02x}"_fmt.format_to(p, b);
+        }
+        benchmark::DoNotOptimize(p);
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * page.size());
+}
+BENCHMARK(BM_PFormatHexPerByte);
+
+static void BM_PFormatHexdump(benchmark::State &state) {
+    using namespace pformat;
+    auto const group = state.range(0);
+    static char buf[3 * 4096 + 1];
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+            "{}"_fmt.format_to(buf, hexdump(page, group)));
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * page.size());
+}
+BENCHMARK(BM_PFormatHexdump)->Arg(0)->Arg(1)->Arg(4)->Arg(16);
+
+// a list of 1000 ids, one format_to per element vs the whole vector
+static std::vector<uint32_t> const ids = [] {
+    std::vector<uint32_t> v(1000);
+    std::mt19937 gen(2);
+    for (auto &id : v) {
+        id = gen() % 10000000;
+    }
+    return v;
+}();
+
+static void BM_PFormatIdsPerElement(benchmark::State &state) {
+    using namespace pformat;
+    static char buf[12 * 1000 + 3];
+    for (auto _ : state) {
+        char *p = buf;
+        *p++ = '[';
+        for (size_t i = 0; i < ids.size(); ++i) {
+            p = "{}"_fmt.format_to(p, ids[i]);
+            if (i + 1 < ids.size()) {
+                p = ", "_fmt.format_to(p);
+            }
+        }
+        *p++ = ']';
+        benchmark::DoNotOptimize(p);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * ids.size());
+}
+BENCHMARK(BM_PFormatIdsPerElement);
+
+static void BM_PFormatIdsVector(benchmark::State &state) {
+    using namespace pformat;
+    static char buf[12 * 1000 + 3];
+    for (auto _ : state) {
+        benchmark::DoNotOptimize("{}"_fmt.format_to(buf, ids));
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * ids.size());
+}
+BENCHMARK(BM_PFormatIdsVector);
+
+// a log record as JSON, formatted directly vs formatted as text and
+// serialized again with a byte by byte escape
+static std::string const json_path = [] {
+    std::string s = "/var/lib/db/\"main\"/";
+    s.resize(256, 'p');
+    return s;
+}();
+
+static void BM_PFormatJson(benchmark::State &state) {
+    using namespace pformat;
+    std::string_view const path(json_path.data(), state.range(0));
+    pformat::memory_buffer buffer;
+    for (auto _ : state) {
+        buffer.clear();
+        "flushed page {page_id} of {path} in {us} us"_fmt.format_json_append(
+            buffer, 27, path, 1234);
+        benchmark::DoNotOptimize(buffer.data());
+    }
+    state.SetBytesProcessed(state.iterations() * path.size());
+}
+BENCHMARK(BM_PFormatJson)->Arg(16)->Arg(64)->Arg(256);
+
+static void BM_PFormatTextThenJson(benchmark::State &state) {
+    using namespace pformat;
+    std::string_view const path(json_path.data(), state.range(0));
+    std::string json;
+    auto escape = [&json](std::string_view s) {
+        for (char c : s) {
+            if (c == '"' || c == '\\') {
+                json += '\\';
+            }
+            json += c;
+        }
+    };
+    for (auto _ : state) {
+        json.clear();
+        auto const msg =
+            "flushed page {} of {} in {} us"_fmt.format(27, path, 1234);
+        json += "{\"msg\":\"";
+        escape(msg);
+        json += "\",\"page_id\":";
+        json += "{}"_fmt.format(27);
+        json += ",\"path\":\"";
+        escape(path);
+        json += "\",\"us\":";
+        json += "{}"_fmt.format(1234);
+        json += "}";
+        benchmark::DoNotOptimize(json.data());
+    }
+    state.SetBytesProcessed(state.iterations() * path.size());
+}
+BENCHMARK(BM_PFormatTextThenJson)->Arg(16)->Arg(64)->Arg(256);
+
+// an ISO-8601 log prefix of time points 1 ms apart, with pformat and
+// with gmtime_r, strftime and snprintf
+static void BM_PFormatTimestamp(benchmark::State &state) {
+    using namespace pformat;
+    static char buf[64];
+    auto t = std::chrono::system_clock::time_point(
+        std::chrono::seconds(1715933742));
+    for (auto _ : state) {
+        t += std::chrono::milliseconds(1);
+        benchmark::DoNotOptimize("{} "_fmt.format_to(buf, t));
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PFormatTimestamp);
+
+static void BM_StrftimeTimestamp(benchmark::State &state) {
+    static char buf[64];
+    auto t = std::chrono::system_clock::time_point(
+        std::chrono::seconds(1715933742));
+    for (auto _ : state) {
+        t += std::chrono::milliseconds(1);
+        int64_t const us =
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                t.time_since_epoch())
+                .count();
+        time_t const sec = us / 1000000;
+        std::tm tm;
+        gmtime_r(&sec, &tm);
+        size_t const n = std::strftime(buf, sizeof(buf), "%FT%T", &tm);
+        benchmark::DoNotOptimize(std::snprintf(buf + n, sizeof(buf) - n,
+                                               ".%06dZ ",
+                                               int(us % 1000000)));
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_StrftimeTimestamp);
+
+// a log prefix and a message, appended in two calls vs concatenated at
+// compile time
+static void BM_PFormatPrefixTwoCalls(benchmark::State &state) {
+    using namespace pformat;
+    pformat::memory_buffer buffer;
+    char level = 'W';
+    int line = 42;
+    int page = 27;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(&level);
+        benchmark::DoNotOptimize(&line);
+        benchmark::DoNotOptimize(&page);
+        buffer.clear();
+        "[{}] {}:{} "_fmt.format_append(buffer, level, s, line);
+        "flushed page {} of {}"_fmt.format_append(buffer, page, s);
+        benchmark::DoNotOptimize(buffer.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PFormatPrefixTwoCalls);
+
+static void BM_PFormatPrefixConcat(benchmark::State &state) {
+    using namespace pformat;
+    pformat::memory_buffer buffer;
+    char level = 'W';
+    int line = 42;
+    int page = 27;
+    constexpr auto f = "[{}] {}:{} "_fmt + "flushed page {} of {}"_fmt;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(&level);
+        benchmark::DoNotOptimize(&line);
+        benchmark::DoNotOptimize(&page);
+        buffer.clear();
+        f.format_append(buffer, level, s, line, page, s);
+        benchmark::DoNotOptimize(buffer.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PFormatPrefixConcat);
@@ -1,5 +1,6 @@
 #include <benchmark/benchmark.h>
 
+#include <cstdint>
 #include <cstdio>
 
 static void BM_Printf(benchmark::State &state) {
@@ -14,3 +15,57 @@ static void BM_Printf(benchmark::State &state) {
     }
 }
 BENCHMARK(BM_Printf)->Range(1, 1 << 4);
+
+static void BM_PrintfDouble(benchmark::State &state) {
+    auto n = state.range(0);
+    double value = 1234.5678;
+    for (auto _ : state) {
+        for (long i = 0; i < n; ++i) {
+            char buf[400];
+            benchmark::DoNotOptimize(buf);
+            benchmark::DoNotOptimize(value);
+            std::snprintf(buf, 400, "foo %f bar", value);
+            benchmark::ClobberMemory();
+        }
+    }
+}
+BENCHMARK(BM_PrintfDouble)->Range(1, 1 << 4);
+
+static void BM_PrintfSpecs(benchmark::State &state) {
+    auto n = state.range(0);
+    uint32_t id = 0xbeef;
+    int value = 42;
+    double ratio = 1234.5678;
+    for (auto _ : state) {
+        for (long i = 0; i < n; ++i) {
+            char buf[400];
+            benchmark::DoNotOptimize(buf);
+            benchmark::DoNotOptimize(id);
+            benchmark::DoNotOptimize(value);
+            benchmark::DoNotOptimize(ratio);
+            std::snprintf(buf, 400, "id %08x value %6d ratio %.3f", id, value,
+                          ratio);
+            benchmark::ClobberMemory();
+        }
+    }
+}
+BENCHMARK(BM_PrintfSpecs)->Range(1, 1 << 4);
+
+static void BM_PrintfLiterals(benchmark::State &state) {
+    auto n = state.range(0);
+    int value = 42;
+    for (auto _ : state) {
+        for (long i = 0; i < n; ++i) {
+            char buf[200];
+            benchmark::DoNotOptimize(buf);
+            benchmark::DoNotOptimize(value);
+            std::snprintf(buf, 200,
+                          "component=storage.engine level=INFO {flush} "
+                          "segment=%d msg=\"segment flushed to disk\" {done} "
+                          "pages=%d bar",
+                          value, value);
+            benchmark::ClobberMemory();
+        }
+    }
+}
+BENCHMARK(BM_PrintfLiterals)->Range(1, 1 << 4);
@@ -1,3 +1,4 @@
 #!/bin/bash
-./pformat_benchmark --benchmark_out=result --benchmark_out_format=console > /dev/null
-cat result
\ No newline at end of file
+# runs the benchmarks, prints the results and writes them as JSON to
+# result.json, e.g. for benchmark/compare.py
+./pformat_benchmark --benchmark_out=result.json --benchmark_out_format=json "$@"
@@ -0,0 +1,434 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "capture.h"
+#include "pformat.h"
+
+namespace pformat {
+
+// what a producer does when the queue of an async_writer is full
+enum class backpressure {
+    // wait until the consumer made space
+    BLOCK,
+    // drop the new message
+    DROP,
+    // drop the oldest queued message
+    OVERWRITE
+};
+
+struct async_options {
+    // number of queued messages, rounded up to a power of two
+    size_t queue_size = 1 << 14;
+    // size of the output blocks handed to the sink
+    size_t block_size = 1 << 20;
+    backpressure policy = backpressure::BLOCK;
+    // maximal time a rendered message waits in a partially filled block
+    std::chrono::milliseconds flush_interval{100};
+};
+
+struct async_stats {
+    // messages queued
+    uint64_t pushed = 0;
+    // messages dropped because the queue was full (DROP)
+    uint64_t dropped = 0;
+    // queued messages dropped to make space (OVERWRITE)
+    uint64_t overwritten = 0;
+    // messages handed to the sink
+    uint64_t written = 0;
+    // number of sink calls
+    uint64_t flushes = 0;
+};
+
+namespace internal {
+
+// bounded lock-free multi-producer/multi-consumer queue of fixed-size
+// record slots (Dmitry Vyukov's bounded MPMC queue).
+//
+// The async_writer has a single consumer. Producers only dequeue to
+// drop the oldest record under the OVERWRITE policy.
+class record_queue {
+   public:
+    static constexpr size_t slot_size = 256;
+
+    struct alignas(64) slot {
+        std::atomic<size_t> sequence;
+        // a record larger than record_capacity, allocated by the producer
+        // and freed by pop_commit. nullptr if the record is stored inline.
+        char *large;
+        char record[slot_size - sizeof(std::atomic<size_t>) - sizeof(char *)];
+
+        char const *data() const noexcept {
+            return large != nullptr ? large : record;
+        }
+    };
+
+    static constexpr size_t record_capacity = sizeof(slot::record);
+
+    explicit record_queue(size_t size)
+        : mask(round_up_pow2(size) - 1), slots(new slot[mask + 1]) {
+        for (size_t i = 0; i <= mask; ++i) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+            slots[i].large = nullptr;
+        }
+    }
+
+    ~record_queue() {
+        for (size_t i = 0; i <= mask; ++i) {
+            delete[] slots[i].large;
+        }
+    }
+
+    // claims a slot for writing. Returns nullptr if the queue is full.
+    // The slot has to be published with push_commit.
+    slot *push_claim(size_t &pos) noexcept {
+        pos = enqueue_pos.load(std::memory_order_relaxed);
+        for (;;) {
+            slot *s = &slots[pos & mask];
+            size_t const seq = s->sequence.load(std::memory_order_acquire);
+            auto const diff =
+                static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos.compare_exchange_weak(
+                        pos, pos + 1, std::memory_order_relaxed)) {
+                    return s;
+                }
+            } else if (diff < 0) {
+                return nullptr;
+            } else {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    static void push_commit(slot *s, size_t pos) noexcept {
+        s->sequence.store(pos + 1, std::memory_order_release);
+    }
+
+    // claims the oldest slot for reading. Returns nullptr if the queue is
+    // empty. The slot has to be released with pop_commit.
+    slot *pop_claim(size_t &pos) noexcept {
+        pos = dequeue_pos.load(std::memory_order_relaxed);
+        for (;;) {
+            slot *s = &slots[pos & mask];
+            size_t const seq = s->sequence.load(std::memory_order_acquire);
+            auto const diff =
+                static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos.compare_exchange_weak(
+                        pos, pos + 1, std::memory_order_relaxed)) {
+                    return s;
+                }
+            } else if (diff < 0) {
+                return nullptr;
+            } else {
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void pop_commit(slot *s, size_t pos) noexcept {
+        delete[] s->large;
+        s->large = nullptr;
+        s->sequence.store(pos + mask + 1, std::memory_order_release);
+    }
+
+    size_t enqueued() const noexcept {
+        return enqueue_pos.load(std::memory_order_acquire);
+    }
+
+    size_t dequeued() const noexcept {
+        return dequeue_pos.load(std::memory_order_acquire);
+    }
+
+   private:
+    static size_t round_up_pow2(size_t v) noexcept {
+        size_t p = 2;
+        while (p < v) {
+            p <<= 1;
+        }
+        return p;
+    }
+
+    size_t const mask;
+    std::unique_ptr<slot[]> const slots;
+    alignas(64) std::atomic<size_t> enqueue_pos{0};
+    alignas(64) std::atomic<size_t> dequeue_pos{0};
+};
+
+}  // namespace internal
+
+/**
+ * Asynchronous front end.
+ *
+ * Producer threads only capture the arguments of a message into a
+ * lock-free queue (see log_config::capture_to). A background thread
+ * renders the messages as lines into large output blocks and hands the
+ * blocks to the sink.
+ */
+class async_writer {
+   public:
+    // receives blocks of rendered, newline terminated messages.
+    // Only called from the background thread.
+    using sink_t = std::function<void(char const *, size_t)>;
+
+    // largest record captured directly into the queue. Larger records
+    // are captured into a heap allocation referenced by the queue.
+    static constexpr size_t max_record_size =
+        internal::record_queue::record_capacity;
+
+    explicit async_writer(sink_t sink_, async_options const &options_ = {})
+        : options(options_),
+          sink(std::move(sink_)),
+          queue(options.queue_size),
+          block(std::max<size_t>(options.block_size, 1 << 16)),
+          consumer([this]() { consume(); }) {}
+
+    async_writer(async_writer const &) = delete;
+    async_writer &operator=(async_writer const &) = delete;
+
+    // writes all queued messages and stops the background thread
+    ~async_writer() {
+        stopping.store(true, std::memory_order_release);
+        wake_consumer(true);
+        consumer.join();
+    }
+
+    /**
+     * Queues a message.
+     *
+     * returns false if the message was dropped.
+     */
+    template <typename log_config_t, typename... args_t>
+    bool write(log_config_t const &config, args_t &&... args) {
+        // the arguments are measured once. Large records are captured
+        // before claiming a slot, so the allocation does not hold up the
+        // consumer, others are captured into the claimed slot.
+        std::unique_ptr<char[]> large;
+        size_t pos;
+        internal::record_queue::slot *s = nullptr;
+        char *end = config.capture_with(
+            [this, &large, &pos, &s](size_t size) -> char * {
+                if (size > max_record_size) {
+                    large.reset(new char[size]);
+                    return large.get();
+                }
+                s = claim(pos);
+                return s == nullptr ? nullptr : s->record;
+            },
+            std::forward<args_t>(args)...);
+        if (large) {
+            s = claim(pos);
+            if (s == nullptr) {
+                return false;
+            }
+            s->large = large.release();
+        } else if (end == nullptr) {
+            return false;
+        }
+        queue.push_commit(s, pos);
+        pushed.fetch_add(1, std::memory_order_relaxed);
+        if (consumer_sleeping.load(std::memory_order_relaxed)) {
+            wake_consumer(false);
+        }
+        return true;
+    }
+
+    /**
+     * Waits until all messages queued before have been handed to the sink.
+     */
+    void flush() {
+        size_t const target = queue.enqueued();
+        std::unique_lock<std::mutex> lock(mutex);
+        if (flush_target.load(std::memory_order_relaxed) < target) {
+            flush_target.store(target, std::memory_order_release);
+        }
+        consumer_cv.notify_one();
+        flushed_cv.wait(lock, [this, target]() {
+            return flushed_pos >= target;
+        });
+    }
+
+    async_stats stats() const noexcept {
+        async_stats s;
+        s.pushed = pushed.load(std::memory_order_relaxed);
+        s.dropped = dropped.load(std::memory_order_relaxed);
+        s.overwritten = overwritten.load(std::memory_order_relaxed);
+        s.written = written.load(std::memory_order_relaxed);
+        s.flushes = flushes.load(std::memory_order_relaxed);
+        return s;
+    }
+
+   private:
+    // claims a slot, waiting or dropping according to the policy while
+    // the queue is full. returns nullptr if the message is dropped.
+    internal::record_queue::slot *claim(size_t &pos) {
+        internal::record_queue::slot *s;
+        while ((s = queue.push_claim(pos)) == nullptr) {
+            if (!handle_full()) {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+        }
+        return s;
+    }
+
+    // called while the queue is full.
+    // returns false if the message should be dropped.
+    bool handle_full() {
+        switch (options.policy) {
+            case backpressure::DROP:
+                return false;
+            case backpressure::OVERWRITE: {
+                size_t pos;
+                if (auto *s = queue.pop_claim(pos)) {
+                    queue.pop_commit(s, pos);
+                    overwritten.fetch_add(1, std::memory_order_relaxed);
+                }
+                return true;
+            }
+            case backpressure::BLOCK:
+            default:
+                wake_consumer(false);
+                std::this_thread::yield();
+                return true;
+        }
+    }
+
+    void wake_consumer(bool always) {
+        if (always || consumer_sleeping.load(std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> lock(mutex);
+            wakeup_requested = true;
+            consumer_cv.notify_one();
+        }
+    }
+
+    void write_block() {
+        if (block_used > 0) {
+            sink(block.data(), block_used);
+            block_used = 0;
+            flushes.fetch_add(1, std::memory_order_relaxed);
+            written.fetch_add(block_records, std::memory_order_relaxed);
+            block_records = 0;
+        }
+    }
+
+    // renders all queued records into the block.
+    // returns the number of rendered records.
+    size_t drain() {
+        size_t count = 0;
+        size_t pos;
+        while (auto *s = queue.pop_claim(pos)) {
+            char const *record = s->data();
+            // +1 for the newline, the trailing zero is overwritten by it
+            size_t const size = binary::render_size_bound(record) + 1;
+            if (block.size() - block_used < size) {
+                write_block();
+                if (block.size() < size) {
+                    block.resize(size);
+                }
+            }
+            if (block_used == 0) {
+                first_pending = std::chrono::steady_clock::now();
+            }
+            char *end = render(record, block.data() + block_used);
+            queue.pop_commit(s, pos);
+            *end++ = '\n';
+            block_used = end - block.data();
+            block_records++;
+            count++;
+        }
+        return count;
+    }
+
+    void consume() {
+        using clock = std::chrono::steady_clock;
+        constexpr auto poll_interval = std::chrono::milliseconds(1);
+        for (;;) {
+            bool const stop = stopping.load(std::memory_order_acquire);
+            size_t const rendered = drain();
+            size_t const drained_pos = queue.dequeued();
+            // flushed_pos is only written by this thread
+            size_t const target = flush_target.load(std::memory_order_acquire);
+            bool const flush_pending = target > flushed_pos;
+            // checked before the queue is empty, so producers keeping it
+            // filled can not delay a flush
+            bool const flush_now = flush_pending && drained_pos >= target;
+            if (rendered > 0 && !stop && !flush_now) {
+                continue;
+            }
+
+            if (flush_now || stop ||
+                (block_used > 0 &&
+                 clock::now() - first_pending >= options.flush_interval)) {
+                write_block();
+                std::lock_guard<std::mutex> lock(mutex);
+                flushed_pos = drained_pos;
+                flushed_cv.notify_all();
+            }
+            if (stop) {
+                return;
+            }
+            if (flush_pending && !flush_now) {
+                // a message before the target is claimed but not yet
+                // committed by its producer
+                std::this_thread::yield();
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(mutex);
+            consumer_sleeping.store(true, std::memory_order_relaxed);
+            consumer_cv.wait_for(lock, poll_interval, [this]() {
+                return wakeup_requested ||
+                       flush_target.load(std::memory_order_relaxed) >
+                           flushed_pos ||
+                       stopping.load(std::memory_order_relaxed);
+            });
+            wakeup_requested = false;
+            consumer_sleeping.store(false, std::memory_order_relaxed);
+        }
+    }
+
+    async_options const options;
+    sink_t const sink;
+    internal::record_queue queue;
+
+    // output block, only used by the consumer thread
+    std::vector<char> block;
+    size_t block_used = 0;
+    // records in the block, counted as written once handed to the sink
+    size_t block_records = 0;
+    std::chrono::steady_clock::time_point first_pending;
+
+    std::atomic<uint64_t> pushed{0};
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<uint64_t> overwritten{0};
+    std::atomic<uint64_t> written{0};
+    std::atomic<uint64_t> flushes{0};
+
+    std::atomic<bool> stopping{false};
+    std::atomic<bool> consumer_sleeping{false};
+    std::mutex mutex;
+    std::condition_variable consumer_cv;
+    std::condition_variable flushed_cv;
+    // queue position flush() waits for, pending while above flushed_pos.
+    // Written under mutex, so a sleeping consumer does not miss it.
+    std::atomic<size_t> flush_target{0};
+    // protected by mutex
+    bool wakeup_requested = false;
+    size_t flushed_pos = 0;
+
+    // started last, after all members are initialized
+    std::thread consumer;
+};
+
+}  // namespace pformat
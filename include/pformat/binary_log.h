@@ -0,0 +1,462 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "capture.h"
+#include "pformat.h"
+
+namespace pformat {
+
+namespace binary {
+
+// Binary log files
+//
+// A log file starts with the file_magic followed by blocks. Each block
+// starts with a block_header.
+//
+// DICTIONARY blocks describe sites: uint32_t count followed by per site
+//   uint64_t id, uint32_t format size, format text,
+//   uint32_t literals size, literal text (see site::literals),
+//   uint32_t parameter count, one arg_type byte per parameter,
+//   uint32_t segment count and per segment
+//     uint8_t is_parameter, uint32_t start, uint32_t size, uint32_t index,
+//     the format spec: char fill, char align, uint8_t zero, char type,
+//     uint32_t width, int32_t precision
+//
+// RECORDS blocks contain records as created by log_config::capture_to, but
+// with the site pointer in the record_header replaced by the site id
+// (see file_record_header).
+//
+// A site is always described before the first RECORDS block using it, so
+// after reading all DICTIONARY blocks every RECORDS block can be decoded
+// independently.
+
+constexpr char file_magic[8] = {'P', 'F', 'M', 'T', 'L', 'O', 'G', '1'};
+
+enum class block_type : uint32_t { DICTIONARY = 1, RECORDS = 2 };
+
+struct block_header {
+    uint32_t magic;
+    block_type type;
+    // size of the block excluding the header
+    uint64_t size;
+};
+
+constexpr uint32_t block_magic = 0x4b4c4250;  // "PBLK"
+
+struct file_record_header {
+    uint32_t size;
+    uint32_t render_size_bound;
+    uint64_t site_id;
+};
+
+static_assert(sizeof(file_record_header) == sizeof(record_header),
+              "records are converted in place");
+
+namespace internal {
+
+inline void append(std::string &out, void const *data, size_t size) {
+    out.append(static_cast<char const *>(data), size);
+}
+
+inline void append_u32(std::string &out, uint32_t value) {
+    append(out, &value, sizeof(value));
+}
+
+inline void append_u64(std::string &out, uint64_t value) {
+    append(out, &value, sizeof(value));
+}
+
+inline void append_site(std::string &out, site const &s) {
+    append_u64(out, s.id);
+    append_u32(out, static_cast<uint32_t>(s.format.size()));
+    append(out, s.format.data(), s.format.size());
+    append_u32(out, static_cast<uint32_t>(s.literals.size()));
+    append(out, s.literals.data(), s.literals.size());
+    append_u32(out, static_cast<uint32_t>(s.parameter_count));
+    append(out, s.arg_types, s.parameter_count);
+    append_u32(out, static_cast<uint32_t>(s.segment_count));
+    for (size_t i = 0; i < s.segment_count; ++i) {
+        auto const &seg = s.segments[i];
+        out.push_back(seg.is_parameter);
+        append_u32(out, seg.start);
+        append_u32(out, seg.size);
+        append_u32(out, seg.index);
+        out.push_back(seg.spec.fill);
+        out.push_back(seg.spec.align);
+        out.push_back(seg.spec.zero);
+        out.push_back(seg.spec.type);
+        append_u32(out, seg.spec.width);
+        append_u32(out, static_cast<uint32_t>(seg.spec.precision));
+    }
+}
+
+}  // namespace internal
+
+/**
+ * Writes messages as binary log.
+ *
+ * Only the site id and the raw arguments of a message are stored, the
+ * text is rendered offline, e.g. with the pformat_decode tool.
+ */
+class log_writer {
+   public:
+    // receives the binary log in blocks
+    using sink_t = std::function<void(char const *, size_t)>;
+
+    explicit log_writer(sink_t sink_, size_t block_size_ = 1 << 20)
+        : sink(std::move(sink_)), block_size(block_size_) {
+        sink(file_magic, sizeof(file_magic));
+        block.reserve(block_size + sizeof(block_header));
+        block.resize(sizeof(block_header));
+    }
+
+    log_writer(log_writer const &) = delete;
+    log_writer &operator=(log_writer const &) = delete;
+
+    ~log_writer() { flush(); }
+
+    template <typename log_config_t, typename... args_t>
+    void write(log_config_t const &config, args_t &&... args) {
+        size_t const size = config.capture_size(args...);
+        if (block.size() + size > sizeof(block_header) + block_size &&
+            block.size() > sizeof(block_header)) {
+            flush();
+        }
+        size_t const offset = block.size();
+        block.resize(offset + size);
+        char *record = block.data() + offset;
+        char *end = config.capture_to(record, std::forward<args_t>(args)...);
+        block.resize(end - block.data());
+
+        // replace the site pointer by the site id
+        record_header header;
+        std::memcpy(&header, record, sizeof(header));
+        file_record_header const file_header{
+            header.size, header.render_size_bound, header.format_site->id};
+        std::memcpy(record, &file_header, sizeof(file_header));
+    }
+
+    // writes all buffered records to the sink
+    void flush() {
+        if (block.size() == sizeof(block_header)) {
+            return;
+        }
+        write_dictionary();
+        write_block(block_type::RECORDS);
+        block.resize(sizeof(block_header));
+    }
+
+   private:
+    void write_block(block_type type) {
+        block_header const header{block_magic, type,
+                                  block.size() - sizeof(block_header)};
+        std::memcpy(block.data(), &header, sizeof(header));
+        sink(block.data(), block.size());
+    }
+
+    // writes the sites registered since the last dictionary.
+    // Sites are pushed to the front of the registry, so the new ones come
+    // before the previously first one.
+    void write_dictionary() {
+        auto const *head = registry_head().load(std::memory_order_acquire);
+        if (head == described_head) {
+            return;
+        }
+        std::string dictionary(sizeof(block_header), '\0');
+        uint32_t count = 0;
+        internal::append_u32(dictionary, count);
+        for (auto *r = head; r != described_head; r = r->next) {
+            internal::append_site(dictionary, r->registered_site);
+            count++;
+        }
+        std::memcpy(dictionary.data() + sizeof(block_header), &count,
+                    sizeof(count));
+        block_header const header{block_magic, block_type::DICTIONARY,
+                                  dictionary.size() - sizeof(block_header)};
+        std::memcpy(dictionary.data(), &header, sizeof(header));
+        sink(dictionary.data(), dictionary.size());
+        described_head = head;
+    }
+
+    sink_t const sink;
+    size_t const block_size;
+    std::vector<char> block;
+    site_registration const *described_head = nullptr;
+};
+
+/**
+ * Renders the records of a binary log from the site metadata alone.
+ *
+ * The arguments are placed with the same placement kernels as
+ * log_config::format uses, so the text is byte-identical.
+ */
+class decoder {
+   public:
+    // reads the sites of a DICTIONARY block.
+    // returns false if the block is malformed or describes a site id that
+    // is already known for a different site.
+    bool add_dictionary(char const *data, size_t size) {
+        char const *end = data + size;
+        uint32_t count;
+        if (!read(data, end, count)) {
+            return false;
+        }
+        for (uint32_t i = 0; i < count; ++i) {
+            decoded_site s;
+            uint32_t format_size, literals_size, parameter_count,
+                segment_count;
+            if (!read(data, end, s.id) || !read(data, end, format_size) ||
+                size_t(end - data) < format_size) {
+                return false;
+            }
+            s.format.assign(data, format_size);
+            data += format_size;
+            if (!read(data, end, literals_size) ||
+                size_t(end - data) < literals_size) {
+                return false;
+            }
+            s.literals.assign(data, literals_size);
+            data += literals_size;
+            if (!read(data, end, parameter_count) ||
+                size_t(end - data) < parameter_count) {
+                return false;
+            }
+            s.arg_types.resize(parameter_count);
+            if (parameter_count > 0) {
+                std::memcpy(s.arg_types.data(), data, parameter_count);
+            }
+            data += parameter_count;
+            if (!read(data, end, segment_count)) {
+                return false;
+            }
+            for (uint32_t j = 0; j < segment_count; ++j) {
+                segment seg{};
+                uint8_t is_parameter, zero;
+                if (!read(data, end, is_parameter) ||
+                    !read(data, end, seg.start) ||
+                    !read(data, end, seg.size) || !read(data, end, seg.index) ||
+                    !read(data, end, seg.spec.fill) ||
+                    !read(data, end, seg.spec.align) ||
+                    !read(data, end, zero) || !read(data, end, seg.spec.type) ||
+                    !read(data, end, seg.spec.width) ||
+                    !read(data, end, seg.spec.precision)) {
+                    return false;
+                }
+                seg.is_parameter = is_parameter != 0;
+                seg.spec.zero = zero != 0;
+                if ((seg.is_parameter && seg.index >= parameter_count) ||
+                    (!seg.is_parameter &&
+                     size_t(seg.start) + seg.size > literals_size) ||
+                    seg.spec.width > pformat::internal::max_spec_width ||
+                    seg.spec.precision > pformat::internal::max_spec_precision) {
+                    return false;
+                }
+                s.segments.push_back(seg);
+            }
+            // a site may be described again, e.g. if it is registered by
+            // multiple shared libraries. A different site with the same
+            // id is ambiguous.
+            auto const found = sites.find(s.id);
+            if (found == sites.end()) {
+                sites.emplace(s.id, std::move(s));
+            } else if (found->second.format != s.format ||
+                       found->second.arg_types != s.arg_types) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Renders all records of a RECORDS block into out, one line per
+     * record.
+     *
+     * returns false if the block is malformed or uses an unknown site.
+     */
+    bool render_block(char const *data, size_t size, std::string &out) const {
+        char const *end = data + size;
+        while (data < end) {
+            file_record_header header;
+            if (size_t(end - data) < sizeof(header)) {
+                return false;
+            }
+            std::memcpy(&header, data, sizeof(header));
+            if (header.size < sizeof(header) ||
+                size_t(end - data) < header.size) {
+                return false;
+            }
+            auto it = sites.find(header.site_id);
+            if (it == sites.end()) {
+                return false;
+            }
+            char const *record_end = data + header.size;
+            // the start of each argument, on the heap only for sites
+            // with many parameters
+            char const *inline_args[32];
+            std::vector<char const *> heap_args;
+            char const **args = inline_args;
+            if (it->second.arg_types.size() > std::size(inline_args)) {
+                heap_args.resize(it->second.arg_types.size());
+                args = heap_args.data();
+            }
+            // the bound is computed from the payload, so a corrupt
+            // record can not overflow the output
+            size_t size_bound;
+            if (!locate(it->second, data + sizeof(header), record_end, args,
+                        size_bound)) {
+                return false;
+            }
+            size_t const offset = out.size();
+            out.resize(offset + size_bound + 1);
+            char *line_end =
+                render(it->second, args, record_end, out.data() + offset);
+            *line_end++ = '\n';
+            out.resize(line_end - out.data());
+            data += header.size;
+        }
+        return true;
+    }
+
+   private:
+    struct decoded_site {
+        uint64_t id = 0;
+        std::string format;
+        std::string literals;
+        std::vector<arg_type> arg_types;
+        std::vector<segment> segments;
+    };
+
+    template <typename value_t>
+    static bool read(char const *&p, char const *end, value_t &value) {
+        if (size_t(end - p) < sizeof(value)) {
+            return false;
+        }
+        std::memcpy(&value, p, sizeof(value));
+        p += sizeof(value);
+        return true;
+    }
+
+    template <typename value_t, typename func_t>
+    static bool visit_scalar(char const *&p, char const *end, func_t &func) {
+        value_t value;
+        if (!read(p, end, value)) {
+            return false;
+        }
+        func(value);
+        return true;
+    }
+
+    // decodes the argument at p, calls func with it and moves p behind it
+    template <typename func_t>
+    static bool visit_arg(arg_type type, char const *&p, char const *end,
+                          func_t &&func) {
+        switch (type) {
+            case arg_type::BOOL: {
+                uint8_t value;
+                if (!read(p, end, value)) {
+                    return false;
+                }
+                func(value != 0);
+                return true;
+            }
+            case arg_type::CHAR:
+                return visit_scalar<char>(p, end, func);
+            case arg_type::INT8:
+                return visit_scalar<int8_t>(p, end, func);
+            case arg_type::INT16:
+                return visit_scalar<int16_t>(p, end, func);
+            case arg_type::INT32:
+                return visit_scalar<int32_t>(p, end, func);
+            case arg_type::INT64:
+                return visit_scalar<int64_t>(p, end, func);
+            case arg_type::UINT8:
+                return visit_scalar<uint8_t>(p, end, func);
+            case arg_type::UINT16:
+                return visit_scalar<uint16_t>(p, end, func);
+            case arg_type::UINT32:
+                return visit_scalar<uint32_t>(p, end, func);
+            case arg_type::UINT64:
+                return visit_scalar<uint64_t>(p, end, func);
+            case arg_type::FLOAT:
+                return visit_scalar<float>(p, end, func);
+            case arg_type::DOUBLE:
+                return visit_scalar<double>(p, end, func);
+            case arg_type::SHORTEST_FLOAT:
+                return visit_scalar<placement::shortest_float<float>>(p, end,
+                                                                      func);
+            case arg_type::SHORTEST_DOUBLE:
+                return visit_scalar<placement::shortest_float<double>>(p, end,
+                                                                       func);
+            case arg_type::STRING: {
+                uint32_t l;
+                if (!read(p, end, l) || size_t(end - p) < l) {
+                    return false;
+                }
+                func(std::string_view(p, l));
+                p += l;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // finds the arguments of a record and computes an upper bound on the
+    // rendered size without the trailing zero
+    static bool locate(decoded_site const &s, char const *payload,
+                       char const *end, char const **args,
+                       size_t &size_bound) {
+        for (size_t i = 0; i < s.arg_types.size(); ++i) {
+            args[i] = payload;
+            if (!visit_arg(s.arg_types[i], payload, end, [](auto const &) {})) {
+                return false;
+            }
+        }
+        size_bound = 0;
+        for (auto const &seg : s.segments) {
+            if (seg.is_parameter) {
+                char const *p = args[seg.index];
+                visit_arg(s.arg_types[seg.index], p, end,
+                          [&size_bound, &seg](auto const &value) {
+                              size_bound += placement::internal::
+                                  placement_size_with_spec(value, seg.spec);
+                          });
+            } else {
+                size_bound += seg.size;
+            }
+        }
+        return true;
+    }
+
+    // renders the located arguments without the trailing zero
+    static char *render(decoded_site const &s, char const *const *args,
+                        char const *end, char *out) {
+        for (auto const &seg : s.segments) {
+            if (seg.is_parameter) {
+                char const *p = args[seg.index];
+                visit_arg(s.arg_types[seg.index], p, end,
+                          [&out, &seg](auto const &value) {
+                              out = placement::internal::place_with_spec(
+                                  out, value, seg.spec);
+                          });
+            } else {
+                std::memcpy(out, s.literals.data() + seg.start, seg.size);
+                out += seg.size;
+            }
+        }
+        return out;
+    }
+
+    std::unordered_map<uint64_t, decoded_site> sites;
+};
+
+}  // namespace binary
+
+}  // namespace pformat
@@ -0,0 +1,371 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "placement.h"
+
+namespace pformat {
+
+namespace binary {
+
+// a binary record captures the arguments of a format call,
+// so that the text can be rendered later, e.g. on a different
+// thread.
+//
+// Layout:
+//  record_header
+//  one encoded value per argument in parameter order:
+//    integers, bools, chars, enums and floating point numbers
+//    as their raw (fixed-width) bytes,
+//    strings as uint32_t length followed by the characters.
+//
+// All values are stored unaligned.
+
+// type of a captured argument
+enum class arg_type : uint8_t {
+    BOOL,
+    CHAR,
+    INT8,
+    INT16,
+    INT32,
+    INT64,
+    UINT8,
+    UINT16,
+    UINT32,
+    UINT64,
+    FLOAT,
+    DOUBLE,
+    SHORTEST_FLOAT,
+    SHORTEST_DOUBLE,
+    STRING
+};
+
+// a literal segment or a parameter of a format string
+struct segment {
+    bool is_parameter;
+    // literal: offset and size within the literals of the site
+    uint32_t start;
+    uint32_t size;
+    // parameter: index of the argument
+    uint32_t index;
+    // parameter: format spec, e.g. {:08x}
+    format_spec spec;
+};
+
+// the format site of a record.
+//
+// There is one site per format string and list of captured types.
+// The metadata describes the site without access to the C++ types,
+// e.g. for offline decoding.
+struct site {
+    // stable id computed from the format string and the argument types.
+    // 64 bits, so ids of different sites practically never collide. A
+    // binary log decoder still rejects conflicting descriptions of an id.
+    uint64_t id;
+    std::string_view format;
+    // the literal text of the format string without escapes.
+    // The literal segments are substrings of it.
+    std::string_view literals;
+    segment const *segments;
+    size_t segment_count;
+    arg_type const *arg_types;
+    size_t parameter_count;
+    // log_config::static_string_size_bound or 0 if the argument types
+    // have no static size bound (e.g. strings)
+    size_t static_size_bound;
+    // renders the payload of a record and returns the end of the output
+    char *(*render)(char const *payload, char *out);
+};
+
+// the 64-bit FNV-1a hash used for site ids
+constexpr uint64_t fnv1a(uint64_t hash, char const *data, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<uint8_t>(data[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+constexpr uint64_t site_id(std::string_view format, arg_type const *types,
+                           size_t count) {
+    uint64_t hash =
+        fnv1a(14695981039346656037ULL, format.data(), format.size());
+    for (size_t i = 0; i < count; ++i) {
+        char const type = static_cast<char>(types[i]);
+        hash = fnv1a(hash, &type, 1);
+    }
+    return hash;
+}
+
+// links a site into the process-wide registry.
+//
+// Sites are registered during static initialization, so the registry is
+// complete when main starts.
+struct site_registration {
+    site const &registered_site;
+    site_registration const *next;
+
+    explicit site_registration(site const &s) noexcept;
+};
+
+inline std::atomic<site_registration const *> &registry_head() noexcept {
+    static std::atomic<site_registration const *> head{nullptr};
+    return head;
+}
+
+inline site_registration::site_registration(site const &s) noexcept
+    : registered_site(s), next(nullptr) {
+    auto &head = registry_head();
+    next = head.load(std::memory_order_relaxed);
+    while (!head.compare_exchange_weak(next, this, std::memory_order_release,
+                                       std::memory_order_relaxed)) {
+    }
+}
+
+// calls func with every registered site
+template <typename func_t>
+void for_each_site(func_t &&func) {
+    for (auto *r = registry_head().load(std::memory_order_acquire);
+         r != nullptr; r = r->next) {
+        func(r->registered_site);
+    }
+}
+
+// returns the registered site with the id or nullptr
+inline site const *find_site(uint64_t id) noexcept {
+    site const *found = nullptr;
+    for_each_site([id, &found](site const &s) {
+        if (found == nullptr && s.id == id) {
+            found = &s;
+        }
+    });
+    return found;
+}
+
+struct record_header {
+    // size of the record in bytes including the header
+    uint32_t size;
+    // upper bound on the rendered size excluding the trailing zero
+    uint32_t render_size_bound;
+    site const *format_site;
+};
+
+// codec defines how a value of type_t is encoded into a record
+// and how it is decoded again.
+//
+// Integers, bools, chars, enums and floating point numbers are stored
+// as is; enums as their underlying type.
+template <typename type_t, typename = void>
+struct codec {
+    // all other placeable types are rendered when they are captured
+    // and stored as string.
+    using decoded_t = std::string_view;
+
+    static size_t encoded_size(type_t const &value) noexcept {
+        using placement::placement_size;
+        return sizeof(uint32_t) + placement_size(value);
+    }
+
+    static char *encode(char *buf, type_t const &value) noexcept {
+        using placement::unsafe_place;
+        char *end = unsafe_place(buf + sizeof(uint32_t), value);
+        auto const l = static_cast<uint32_t>(end - buf - sizeof(uint32_t));
+        std::memcpy(buf, &l, sizeof(l));
+        return end;
+    }
+
+    static decoded_t decode(char const *&p) noexcept {
+        uint32_t l;
+        std::memcpy(&l, p, sizeof(l));
+        decoded_t value{p + sizeof(l), l};
+        p += sizeof(l) + l;
+        return value;
+    }
+};
+
+template <typename type_t>
+struct scalar_codec {
+    using decoded_t = type_t;
+
+    static constexpr size_t encoded_size(type_t const &) noexcept {
+        return sizeof(type_t);
+    }
+
+    static char *encode(char *buf, type_t const &value) noexcept {
+        std::memcpy(buf, &value, sizeof(value));
+        return buf + sizeof(value);
+    }
+
+    static decoded_t decode(char const *&p) noexcept {
+        decoded_t value;
+        std::memcpy(&value, p, sizeof(value));
+        p += sizeof(value);
+        return value;
+    }
+};
+
+template <typename type_t>
+struct codec<type_t, typename std::enable_if<
+                         std::is_arithmetic<type_t>::value>::type>
+    : scalar_codec<type_t> {};
+
+template <typename float_t>
+struct codec<placement::shortest_float<float_t>>
+    : scalar_codec<placement::shortest_float<float_t>> {};
+
+template <typename enum_t>
+struct codec<enum_t,
+             typename std::enable_if<std::is_enum<enum_t>::value>::type>
+    : scalar_codec<typename std::underlying_type<enum_t>::type> {
+    using underlying_t = typename std::underlying_type<enum_t>::type;
+
+    static constexpr size_t encoded_size(enum_t const &) noexcept {
+        return sizeof(underlying_t);
+    }
+
+    static char *encode(char *buf, enum_t const &value) noexcept {
+        return scalar_codec<underlying_t>::encode(
+            buf, static_cast<underlying_t>(value));
+    }
+};
+
+// long double is captured as double, as which it is placed
+template <>
+struct codec<long double> : scalar_codec<double> {
+    static constexpr size_t encoded_size(long double const &) noexcept {
+        return sizeof(double);
+    }
+
+    static char *encode(char *buf, long double const &value) noexcept {
+        return scalar_codec<double>::encode(buf, static_cast<double>(value));
+    }
+};
+
+struct string_codec {
+    using decoded_t = std::string_view;
+
+    static size_t encoded_size(std::string_view const &value) noexcept {
+        return sizeof(uint32_t) + value.size();
+    }
+
+    static char *encode(char *buf, std::string_view const &value) noexcept {
+        auto const l = static_cast<uint32_t>(value.size());
+        std::memcpy(buf, &l, sizeof(l));
+        std::memcpy(buf + sizeof(l), value.data(), l);
+        return buf + sizeof(l) + l;
+    }
+
+    static decoded_t decode(char const *&p) noexcept {
+        uint32_t l;
+        std::memcpy(&l, p, sizeof(l));
+        decoded_t value{p + sizeof(l), l};
+        p += sizeof(l) + l;
+        return value;
+    }
+};
+
+template <>
+struct codec<std::string_view> : string_codec {};
+
+template <>
+struct codec<std::string> : string_codec {};
+
+// C strings are captured as string_view, see
+// placement::internal::measured_t
+template <typename type_t>
+using codec_t = codec<typename std::decay<type_t>::type>;
+
+// the type a value of type_t is rendered from
+template <typename type_t>
+using decoded_t = typename codec_t<type_t>::decoded_t;
+
+// the arg_type of a decoded type
+template <typename decoded_t>
+constexpr arg_type arg_type_of() noexcept {
+    if constexpr (std::is_same<decoded_t, bool>::value) {
+        return arg_type::BOOL;
+    } else if constexpr (std::is_same<decoded_t, char>::value) {
+        return arg_type::CHAR;
+    } else if constexpr (std::is_integral<decoded_t>::value) {
+        constexpr arg_type types[2][4] = {
+            {arg_type::UINT8, arg_type::UINT16, arg_type::UINT32,
+             arg_type::UINT64},
+            {arg_type::INT8, arg_type::INT16, arg_type::INT32,
+             arg_type::INT64}};
+        constexpr int width = sizeof(decoded_t) == 1   ? 0
+                              : sizeof(decoded_t) == 2 ? 1
+                              : sizeof(decoded_t) == 4 ? 2
+                                                       : 3;
+        return types[std::is_signed<decoded_t>::value][width];
+    } else if constexpr (std::is_same<decoded_t, float>::value) {
+        return arg_type::FLOAT;
+    } else if constexpr (std::is_same<decoded_t, double>::value) {
+        return arg_type::DOUBLE;
+    } else if constexpr (std::is_same<
+                             decoded_t,
+                             placement::shortest_float<float>>::value) {
+        return arg_type::SHORTEST_FLOAT;
+    } else if constexpr (std::is_same<
+                             decoded_t,
+                             placement::shortest_float<double>>::value) {
+        return arg_type::SHORTEST_DOUBLE;
+    } else {
+        static_assert(std::is_same<decoded_t, std::string_view>::value,
+                      "Unexpected decoded type");
+        return arg_type::STRING;
+    }
+}
+
+static_assert(arg_type_of<int8_t>() == arg_type::INT8);
+static_assert(arg_type_of<uint64_t>() == arg_type::UINT64);
+static_assert(arg_type_of<char>() == arg_type::CHAR);
+
+// the total size of a record
+inline size_t record_size(char const *record) noexcept {
+    record_header header;
+    std::memcpy(&header, record, sizeof(header));
+    return header.size;
+}
+
+// upper bound on the size of the rendered text of a record
+// including the trailing zero
+inline size_t render_size_bound(char const *record) noexcept {
+    record_header header;
+    std::memcpy(&header, record, sizeof(header));
+    return header.render_size_bound + 1;
+}
+
+}  // namespace binary
+
+/**
+ * Renders a record created by log_config::capture_to into out.
+ *
+ * out has to provide binary::render_size_bound(record) many chars.
+ * The output is identical to the output of log_config::format with the
+ * captured arguments.
+ */
+inline char *render(char const *record, char *out) noexcept {
+    binary::record_header header;
+    std::memcpy(&header, record, sizeof(header));
+    char *end = header.format_site->render(record + sizeof(header), out);
+    *end = 0;
+    return end;
+}
+
+/**
+ * Renders a record created by log_config::capture_to into a string.
+ */
+inline std::string render(char const *record) {
+    std::string result;
+    result.resize(binary::render_size_bound(record));
+    char *end = render(record, result.data());
+    result.resize(end - result.data());
+    return result;
+}
+
+}  // namespace pformat
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+
+#include "placement.h"
+#include "spec.h"
+
+namespace pformat {
+namespace placement {
+namespace internal {
+
+// Placement kernels usable in constant expressions, see
+// log_config::format_constexpr.
+//
+// They place one character at a time and are not used on the runtime
+// paths, which rely on memcpy and lookup tables.
+
+// output of the constexpr kernels. Never writes more than capacity
+// characters, but counts all of them, so a writer with capacity 0
+// measures.
+struct constexpr_writer {
+    char *data;
+    size_t capacity;
+    size_t size = 0;
+
+    constexpr void put(char c) noexcept {
+        if (size < capacity) {
+            data[size] = c;
+        }
+        size++;
+    }
+
+    constexpr void put(char c, size_t count) noexcept {
+        for (size_t i = 0; i < count; ++i) {
+            put(c);
+        }
+    }
+
+    constexpr void put(std::string_view s) noexcept {
+        for (char c : s) {
+            put(c);
+        }
+    }
+};
+
+// the types the constexpr kernels can place: integers, bools, chars,
+// enums, string literals, C strings and string_views
+template <typename type_t>
+constexpr bool is_constexpr_placeable() noexcept {
+    if constexpr (std::is_enum<type_t>::value) {
+        return is_constexpr_placeable<
+            typename std::underlying_type<type_t>::type>();
+    } else {
+        using decayed_t = typename std::decay<type_t>::type;
+        return std::is_integral<type_t>::value ||
+               std::is_same<decayed_t, char const *>::value ||
+               std::is_same<decayed_t, char *>::value ||
+               std::is_same<type_t, std::string_view>::value;
+    }
+}
+
+// true if the placed size of every value of type_t is bounded,
+// i.e. for all constexpr placeable types except C strings and
+// string_views
+template <typename type_t>
+constexpr bool has_constexpr_static_size() noexcept {
+    return std::is_array<type_t>::value ||
+           (has_static_placement_size<type_t>::value &&
+            is_constexpr_placeable<type_t>());
+}
+
+// upper bound of the characters a value of type_t takes with the spec,
+// string literals count with their length
+template <typename spec_t, typename type_t>
+constexpr size_t constexpr_static_size() noexcept {
+    if constexpr (std::is_array<type_t>::value) {
+        return std::max<size_t>(std::extent<type_t>::value - 1,
+                                spec_t::value.width);
+    } else {
+        return static_placement_size_spec<spec_t, type_t>();
+    }
+}
+
+template <typename uint_t>
+constexpr void constexpr_place_digits(constexpr_writer &out, uint_t value,
+                                      unsigned base, bool upper) noexcept {
+    char const *digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+    uint_t divisor = 1;
+    while (value / divisor >= base) {
+        divisor *= base;
+    }
+    for (; divisor > 0; divisor /= base) {
+        out.put(digits[value / divisor % base]);
+    }
+}
+
+// places the value as the type of the spec asks for, without padding.
+// zeros are placed after the sign of a number.
+template <typename type_t>
+constexpr void constexpr_place_value(constexpr_writer &out,
+                                     type_t const &value,
+                                     format_spec const &spec,
+                                     size_t zeros = 0) noexcept {
+    if constexpr (std::is_enum<type_t>::value) {
+        using int_t = typename std::underlying_type<type_t>::type;
+        constexpr_place_value(out, static_cast<int_t>(value), spec, zeros);
+    } else if constexpr (std::is_same<type_t, bool>::value) {
+        out.put(value ? "true" : "false");
+    } else if constexpr (std::is_same<type_t, char>::value) {
+        out.put(value);
+    } else if constexpr (std::is_integral<type_t>::value) {
+        using uint_t = kernel_uint_t<type_t>;
+        uint_t abs_value = static_cast<uint_t>(value);
+        if constexpr (std::is_signed<type_t>::value) {
+            if (value < 0) {
+                abs_value = uint_t() - abs_value;
+                out.put('-');
+            }
+        }
+        out.put('0', zeros);
+        bool const hex = spec.type == 'x' || spec.type == 'X';
+        constexpr_place_digits(out, abs_value, hex ? 16 : 10,
+                               spec.type == 'X');
+    } else {
+        out.put(std::string_view(value));
+    }
+}
+
+// places the value padded to the width of the spec,
+// see place_spec_padding
+template <typename type_t>
+constexpr void constexpr_place_with_spec(constexpr_writer &out,
+                                         type_t const &value,
+                                         format_spec const &spec) noexcept {
+    constexpr_writer counter{nullptr, 0};
+    constexpr_place_value(counter, value, spec);
+    if (counter.size >= spec.width) {
+        constexpr_place_value(out, value, spec);
+        return;
+    }
+    size_t const padding = spec.width - counter.size;
+    constexpr bool number =
+        std::is_enum<type_t>::value || is_spec_number<type_t>();
+    char fill = spec.fill;
+    char align = spec.align;
+    if (align == 0) {
+        align = number ? '>' : '<';
+        if (spec.zero && number) {
+            constexpr_place_value(out, value, spec, padding);
+            return;
+        }
+        if (spec.zero) {
+            fill = ' ';
+        }
+    }
+    size_t const before =
+        align == '>' ? padding : align == '^' ? padding / 2 : 0;
+    out.put(fill, before);
+    constexpr_place_value(out, value, spec);
+    out.put(fill, padding - before);
+}
+
+// the constexpr placement function for a spec_constant
+template <typename spec_t, typename type_t>
+constexpr void constexpr_place_spec(constexpr_writer &out,
+                                    type_t const &value) noexcept {
+    constexpr format_spec spec = spec_t::value;
+    static_assert(is_valid_spec<typename std::decay<type_t>::type>(spec),
+                  "Format spec does not match the argument type");
+    constexpr_place_with_spec(out, value, spec);
+}
+
+// called by log_config::format_constexpr if the output exceeds the
+// capacity. Not constexpr, so this is a compile error in a constant
+// expression. At runtime the output is truncated.
+inline void format_constexpr_capacity_exceeded() noexcept {}
+
+}  // namespace internal
+}  // namespace placement
+}  // namespace pformat
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "memory_buffer.h"
+#include "pformat.h"
+
+namespace pformat {
+
+struct export_options {
+    // number of formatting threads, 0 for one per core
+    unsigned threads = 0;
+    // rows formatted into one buffer and written with one write call
+    size_t chunk_rows = 1 << 16;
+    // maximal number of formatted chunks waiting to be written,
+    // 0 for two per thread
+    size_t window = 0;
+};
+
+struct export_result {
+    // rows and bytes written completely
+    uint64_t rows = 0;
+    uint64_t bytes = 0;
+    // errno of the failed write or 0
+    int error = 0;
+};
+
+namespace internal {
+
+// returns errno of the failed write or 0
+inline int write_all(int fd, char const *data, size_t size) noexcept {
+    while (size > 0) {
+        ssize_t const written = ::write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno;
+        }
+        data += written;
+        size -= written;
+    }
+    return 0;
+}
+
+}  // namespace internal
+
+/**
+ * Writes count rows to the file descriptor, each row formatted with the
+ * format, e.g. "{},{},{}\n"_fmt for CSV. Each row is a std::tuple of the
+ * arguments of one format call.
+ *
+ * The rows are split into chunks of options.chunk_rows rows, which are
+ * formatted in parallel with log_config::format_batch and written in
+ * order, so the output is identical to a single-threaded export. At most
+ * options.window formatted chunks are held in memory. Their buffers are
+ * reused, so the memory footprint does not grow with count.
+ *
+ * Stops at the first failed write.
+ */
+template <typename log_config_t, typename... args_t>
+export_result export_rows(int fd, log_config_t const &format,
+                          std::tuple<args_t...> const *rows, size_t count,
+                          export_options const &options = {}) {
+    size_t const chunk_rows = std::max<size_t>(options.chunk_rows, 1);
+    size_t const chunks = (count + chunk_rows - 1) / chunk_rows;
+    unsigned const threads = std::min<size_t>(
+        options.threads > 0 ? options.threads
+                            : std::max(1u, std::thread::hardware_concurrency()),
+        chunks);
+
+    auto format_chunk = [&](size_t i, memory_buffer &buffer) {
+        size_t const begin = i * chunk_rows;
+        buffer.clear();
+        format.format_batch(rows + begin, std::min(chunk_rows, count - begin),
+                            buffer, "");
+    };
+
+    export_result result;
+    auto write_chunk = [&](size_t i, memory_buffer const &buffer) {
+        result.error = internal::write_all(fd, buffer.data(), buffer.size());
+        if (result.error == 0) {
+            result.rows += std::min(chunk_rows, count - i * chunk_rows);
+            result.bytes += buffer.size();
+        }
+        return result.error == 0;
+    };
+
+    if (threads <= 1) {
+        memory_buffer buffer;
+        for (size_t i = 0; i < chunks; ++i) {
+            format_chunk(i, buffer);
+            if (!write_chunk(i, buffer)) {
+                break;
+            }
+        }
+        return result;
+    }
+
+    // workers format chunks in order into a ring of window buffers, the
+    // calling thread writes them in order
+    struct slot {
+        memory_buffer buffer;
+        bool ready = false;
+    };
+    size_t const window = options.window > 0 ? options.window : 2 * threads;
+    std::vector<slot> slots(window);
+    std::atomic<size_t> next_chunk{0};
+    std::mutex mutex;
+    std::condition_variable ready_cv;
+    std::condition_variable space_cv;
+    // protected by mutex
+    size_t written_chunks = 0;
+    bool stopped = false;
+
+    auto worker = [&]() {
+        for (;;) {
+            size_t const i = next_chunk.fetch_add(1);
+            if (i >= chunks) {
+                return;
+            }
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                space_cv.wait(lock, [&]() {
+                    return stopped || i < written_chunks + window;
+                });
+                if (stopped) {
+                    return;
+                }
+            }
+            // the slot is owned by this worker until it is ready
+            slot &s = slots[i % window];
+            format_chunk(i, s.buffer);
+            std::lock_guard<std::mutex> lock(mutex);
+            s.ready = true;
+            ready_cv.notify_one();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; ++t) {
+        workers.emplace_back(worker);
+    }
+
+    for (size_t i = 0; i < chunks; ++i) {
+        slot &s = slots[i % window];
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            ready_cv.wait(lock, [&]() { return s.ready; });
+        }
+        bool const ok = write_chunk(i, s.buffer);
+        std::lock_guard<std::mutex> lock(mutex);
+        s.ready = false;
+        written_chunks = i + 1;
+        stopped = !ok;
+        space_cv.notify_all();
+        if (stopped) {
+            break;
+        }
+    }
+    for (auto &w : workers) {
+        w.join();
+    }
+    return result;
+}
+
+/**
+ * Writes the rows to the file descriptor, see export_rows.
+ */
+template <typename log_config_t, typename... args_t>
+export_result export_rows(int fd, log_config_t const &format,
+                          std::vector<std::tuple<args_t...>> const &rows,
+                          export_options const &options = {}) {
+    return export_rows(fd, format, rows.data(), rows.size(), options);
+}
+
+}  // namespace pformat
@@ -6,23 +6,61 @@
 namespace pformat {
 namespace internal {
 
+// C++17 constexpr constructors have to initialize all members, later
+// ones may leave the storage of a fixed_string uninitialized
+#if __cpp_constexpr >= 201907L
+#define PFORMAT_FIXED_STRING_STORAGE_INIT
+#else
+#define PFORMAT_FIXED_STRING_STORAGE_INIT str{},
+#endif
+
+// selects the fixed_string constructor that does not zero-fill
+struct uninitialized_t {};
+constexpr uninitialized_t uninitialized{};
+
 /**
  * very simplified constexpr fixed string
  * based on document P0259R0, P0732R2
+ *
+ * Only the characters up to the trailing zero are written at runtime:
+ * format_fixed does not zero-fill its output and copies copy size + 1
+ * characters (after zero-filling in C++17, see above). Constant
+ * expressions initialize all characters, as their results have to be
+ * fully initialized.
  */
 template <size_t N>
 struct fixed_string {
-    char str[N] = {};
-    size_t internal_size = 0;
+    char str[N];
+    size_t internal_size;
+
+    constexpr fixed_string() noexcept
+        : PFORMAT_FIXED_STRING_STORAGE_INIT internal_size(0) {
+        if (__builtin_is_constant_evaluated()) {
+            clear_from(0);
+        } else {
+            str[0] = 0;
+        }
+    }
 
-    constexpr fixed_string(const fixed_string& other) noexcept {
-        for (size_t i{0}; i <= N; ++i) {
+    // an empty string without a constant expression, e.g. as output of
+    // log_config::format_fixed
+    explicit fixed_string(uninitialized_t) noexcept : internal_size(0) {
+        str[0] = 0;
+    }
+
+    constexpr fixed_string(const fixed_string& other) noexcept
+        : PFORMAT_FIXED_STRING_STORAGE_INIT
+          internal_size(other.internal_size) {
+        for (size_t i = 0; i <= internal_size; ++i) {
             str[i] = other.str[i];
         }
-        internal_size = other.internal_size;
+        if (__builtin_is_constant_evaluated()) {
+            clear_from(internal_size + 1);
+        }
     }
 
-    constexpr fixed_string(const char (&input)[N]) noexcept {
+    constexpr fixed_string(const char (&input)[N]) noexcept
+        : PFORMAT_FIXED_STRING_STORAGE_INIT internal_size(0) {
         for (size_t i = 0; i < N; ++i) {
             str[i] = input[i];
             if (input[i] == 0) {
@@ -30,6 +68,9 @@ struct fixed_string {
             }
             internal_size++;
         }
+        if (__builtin_is_constant_evaluated()) {
+            clear_from(internal_size + 1);
+        }
     }
 
     constexpr size_t size() const noexcept { return internal_size; }
@@ -39,9 +80,28 @@ struct fixed_string {
 
     constexpr const char* c_str() const { return str; }
 
+    // capacity including the trailing zero
+    static constexpr size_t capacity() noexcept { return N; }
+
+    constexpr char* data() noexcept { return str; }
+
+    // sets the size after writing into data().
+    // size has to be smaller than the capacity.
+    constexpr void resize(size_t size) noexcept {
+        internal_size = size;
+        str[size] = 0;
+    }
+
     constexpr std::string_view view() const {
         return {c_str(), size()};
     }
+
+   private:
+    constexpr void clear_from(size_t i) noexcept {
+        for (; i < N; ++i) {
+            str[i] = 0;
+        }
+    }
 };
 
 static_assert(fixed_string<1>("").size() == 0);
@@ -51,4 +111,6 @@ static_assert(fixed_string<3>("ab")[1] == 'b');
 static_assert(fixed_string<3>("ab")[2] == 0);
 
 }  // namespace internal
-}  // namespace pformat
\ No newline at end of file
+}  // namespace pformat
+
+#undef PFORMAT_FIXED_STRING_STORAGE_INIT
\ No newline at end of file
@@ -0,0 +1,540 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+#include "integer.h"
+
+namespace pformat {
+
+namespace placement {
+
+namespace internal {
+
+// floating point kernels
+//
+// fixed notation (printf's %f) is computed exactly with 128-bit integer
+// arithmetic. The round-trip representation uses Grisu2 (Florian Loitsch,
+// "Printing Floating-Point Numbers Quickly and Accurately with Integers",
+// PLDI 2010). Grisu2 always reads back as the value, its digits are the
+// shortest ones for almost all, but not all values.
+
+template <typename float_t>
+struct float_traits {
+    static_assert(std::numeric_limits<float_t>::is_iec559 &&
+                      (sizeof(float_t) == 4 || sizeof(float_t) == 8),
+                  "Only IEEE-754 float and double are supported");
+    using bits_t =
+        typename std::conditional<sizeof(float_t) == 4, uint32_t,
+                                  uint64_t>::type;
+
+    // significand bits including the hidden bit
+    static constexpr int precision = std::numeric_limits<float_t>::digits;
+    static constexpr int bias =
+        std::numeric_limits<float_t>::max_exponent - 1 + (precision - 1);
+    static constexpr int min_exponent = 1 - bias;
+    static constexpr uint64_t hidden_bit = uint64_t{1} << (precision - 1);
+    static constexpr int exponent_mask =
+        2 * std::numeric_limits<float_t>::max_exponent - 1;
+
+    // maximal number of significant digits of the round-trip representation
+    static constexpr int max_digits = std::numeric_limits<float_t>::max_digits10;
+    // number of decimal digits of the largest integral part
+    static constexpr int max_integral_digits =
+        std::numeric_limits<float_t>::max_exponent10 + 1;
+};
+
+// a binary floating point number f * 2^e (the "do-it-yourself" floating
+// point of the Grisu paper)
+struct diy_fp {
+    uint64_t f = 0;
+    int e = 0;
+
+    static diy_fp sub(diy_fp x, diy_fp y) noexcept { return {x.f - y.f, x.e}; }
+
+    // rounded upper 64-bit of the 128-bit product
+    static diy_fp mul(diy_fp x, diy_fp y) noexcept {
+        unsigned __int128 const p =
+            static_cast<unsigned __int128>(x.f) * y.f;
+        uint64_t h = static_cast<uint64_t>(p >> 64);
+        h += (static_cast<uint64_t>(p) >> 63);
+        return {h, x.e + y.e + 64};
+    }
+
+    static diy_fp normalize(diy_fp x) noexcept {
+        int const s = __builtin_clzll(x.f);
+        return {x.f << s, x.e - s};
+    }
+
+    static diy_fp normalize_to(diy_fp x, int target_e) noexcept {
+        return {x.f << (x.e - target_e), target_e};
+    }
+};
+
+// cached normalized powers of ten c = f * 2^e ~ 10^k
+struct cached_power {
+    uint64_t f;
+    int e;
+    int k;
+};
+
+// the powers of ten from 10^-300 to 10^324 in steps of 8
+inline constexpr cached_power cached_powers[] = {
+        {0xAB70FE17C79AC6CA, -1060, -300},
+        {0xFF77B1FCBEBCDC4F, -1034, -292},
+        {0xBE5691EF416BD60C, -1007, -284},
+        {0x8DD01FAD907FFC3C, -980, -276},
+        {0xD3515C2831559A83, -954, -268},
+        {0x9D71AC8FADA6C9B5, -927, -260},
+        {0xEA9C227723EE8BCB, -901, -252},
+        {0xAECC49914078536D, -874, -244},
+        {0x823C12795DB6CE57, -847, -236},
+        {0xC21094364DFB5637, -821, -228},
+        {0x9096EA6F3848984F, -794, -220},
+        {0xD77485CB25823AC7, -768, -212},
+        {0xA086CFCD97BF97F4, -741, -204},
+        {0xEF340A98172AACE5, -715, -196},
+        {0xB23867FB2A35B28E, -688, -188},
+        {0x84C8D4DFD2C63F3B, -661, -180},
+        {0xC5DD44271AD3CDBA, -635, -172},
+        {0x936B9FCEBB25C996, -608, -164},
+        {0xDBAC6C247D62A584, -582, -156},
+        {0xA3AB66580D5FDAF6, -555, -148},
+        {0xF3E2F893DEC3F126, -529, -140},
+        {0xB5B5ADA8AAFF80B8, -502, -132},
+        {0x87625F056C7C4A8B, -475, -124},
+        {0xC9BCFF6034C13053, -449, -116},
+        {0x964E858C91BA2655, -422, -108},
+        {0xDFF9772470297EBD, -396, -100},
+        {0xA6DFBD9FB8E5B88F, -369, -92},
+        {0xF8A95FCF88747D94, -343, -84},
+        {0xB94470938FA89BCF, -316, -76},
+        {0x8A08F0F8BF0F156B, -289, -68},
+        {0xCDB02555653131B6, -263, -60},
+        {0x993FE2C6D07B7FAC, -236, -52},
+        {0xE45C10C42A2B3B06, -210, -44},
+        {0xAA242499697392D3, -183, -36},
+        {0xFD87B5F28300CA0E, -157, -28},
+        {0xBCE5086492111AEB, -130, -20},
+        {0x8CBCCC096F5088CC, -103, -12},
+        {0xD1B71758E219652C, -77, -4},
+        {0x9C40000000000000, -50, 4},
+        {0xE8D4A51000000000, -24, 12},
+        {0xAD78EBC5AC620000, 3, 20},
+        {0x813F3978F8940984, 30, 28},
+        {0xC097CE7BC90715B3, 56, 36},
+        {0x8F7E32CE7BEA5C70, 83, 44},
+        {0xD5D238A4ABE98068, 109, 52},
+        {0x9F4F2726179A2245, 136, 60},
+        {0xED63A231D4C4FB27, 162, 68},
+        {0xB0DE65388CC8ADA8, 189, 76},
+        {0x83C7088E1AAB65DB, 216, 84},
+        {0xC45D1DF942711D9A, 242, 92},
+        {0x924D692CA61BE758, 269, 100},
+        {0xDA01EE641A708DEA, 295, 108},
+        {0xA26DA3999AEF774A, 322, 116},
+        {0xF209787BB47D6B85, 348, 124},
+        {0xB454E4A179DD1877, 375, 132},
+        {0x865B86925B9BC5C2, 402, 140},
+        {0xC83553C5C8965D3D, 428, 148},
+        {0x952AB45CFA97A0B3, 455, 156},
+        {0xDE469FBD99A05FE3, 481, 164},
+        {0xA59BC234DB398C25, 508, 172},
+        {0xF6C69A72A3989F5C, 534, 180},
+        {0xB7DCBF5354E9BECE, 561, 188},
+        {0x88FCF317F22241E2, 588, 196},
+        {0xCC20CE9BD35C78A5, 614, 204},
+        {0x98165AF37B2153DF, 641, 212},
+        {0xE2A0B5DC971F303A, 667, 220},
+        {0xA8D9D1535CE3B396, 694, 228},
+        {0xFB9B7CD9A4A7443C, 720, 236},
+        {0xBB764C4CA7A44410, 747, 244},
+        {0x8BAB8EEFB6409C1A, 774, 252},
+        {0xD01FEF10A657842C, 800, 260},
+        {0x9B10A4E5E9913129, 827, 268},
+        {0xE7109BFBA19C0C9D, 853, 276},
+        {0xAC2820D9623BF429, 880, 284},
+        {0x80444B5E7AA7CF85, 907, 292},
+        {0xBF21E44003ACDD2D, 933, 300},
+        {0x8E679C2F5E44FF8F, 960, 308},
+        {0xD433179D9C8CB841, 986, 316},
+        {0x9E19DB92B4E31BA9, 1013, 324}};
+
+// Grisu2 works best if the product of the value and the cached power
+// has a binary exponent within [alpha, gamma]
+constexpr int grisu_alpha = -60;
+constexpr int grisu_gamma = -32;
+
+inline cached_power get_cached_power(int e) noexcept {
+    constexpr int min_decimal_exponent = -300;
+    constexpr int decimal_step = 8;
+    // k = ceil((alpha - e - 1) * log10(2))
+    int const f = grisu_alpha - e - 1;
+    int const k = (f * 78913) / (1 << 18) + (f > 0);
+    int const index =
+        (-min_decimal_exponent + k + (decimal_step - 1)) / decimal_step;
+    return cached_powers[index];
+}
+
+// the value v and its rounding boundaries m- and m+.
+// Every number within (m-, m+) rounds to v.
+struct float_boundaries {
+    diy_fp w;
+    diy_fp minus;
+    diy_fp plus;
+};
+
+template <typename float_t>
+float_boundaries compute_boundaries(float_t value) noexcept {
+    using traits = float_traits<float_t>;
+    typename traits::bits_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    uint64_t const fraction = bits & (traits::hidden_bit - 1);
+    int const exponent = (bits >> (traits::precision - 1)) & traits::exponent_mask;
+
+    diy_fp const v = exponent == 0
+                         ? diy_fp{fraction, traits::min_exponent}
+                         : diy_fp{fraction + traits::hidden_bit,
+                                  exponent - traits::bias};
+
+    // the lower boundary is closer if the significand is a power of two
+    bool const lower_boundary_is_closer = fraction == 0 && exponent > 1;
+    diy_fp const m_plus{2 * v.f + 1, v.e - 1};
+    diy_fp const m_minus = lower_boundary_is_closer
+                               ? diy_fp{4 * v.f - 1, v.e - 2}
+                               : diy_fp{2 * v.f - 1, v.e - 1};
+    diy_fp const w_plus = diy_fp::normalize(m_plus);
+    diy_fp const w_minus = diy_fp::normalize_to(m_minus, w_plus.e);
+    return {diy_fp::normalize(v), w_minus, w_plus};
+}
+
+// largest power of ten <= n (n > 0); returns the number of digits of n
+inline int find_largest_pow10(uint32_t n, uint32_t &pow10) noexcept {
+    int const digits = count_digits(n);
+    pow10 = digits == 1 ? 1 : powers10_32[digits - 1];
+    return digits;
+}
+
+inline void grisu2_round(char *buf, int len, uint64_t dist, uint64_t delta,
+                         uint64_t rest, uint64_t ten_k) noexcept {
+    // move the last digit towards w as long as the result stays within
+    // the boundaries
+    while (rest < dist && delta - rest >= ten_k &&
+           (rest + ten_k < dist || dist - rest > rest + ten_k - dist)) {
+        buf[len - 1]--;
+        rest += ten_k;
+    }
+}
+
+// generates the digits of m+ until they are within (m-, m+)
+inline int grisu2_digit_gen(char *buf, int &decimal_exponent, diy_fp m_minus,
+                            diy_fp w, diy_fp m_plus) noexcept {
+    uint64_t delta = diy_fp::sub(m_plus, m_minus).f;
+    uint64_t dist = diy_fp::sub(m_plus, w).f;
+
+    diy_fp const one{uint64_t{1} << -m_plus.e, m_plus.e};
+    auto p1 = static_cast<uint32_t>(m_plus.f >> -one.e);
+    uint64_t p2 = m_plus.f & (one.f - 1);
+
+    int len = 0;
+    uint32_t pow10;
+    int n = find_largest_pow10(p1, pow10);
+    while (n > 0) {
+        uint32_t const d = p1 / pow10;
+        p1 %= pow10;
+        buf[len++] = static_cast<char>('0' + d);
+        n--;
+        uint64_t const rest = (static_cast<uint64_t>(p1) << -one.e) + p2;
+        if (rest <= delta) {
+            decimal_exponent += n;
+            grisu2_round(buf, len, dist, delta, rest,
+                         static_cast<uint64_t>(pow10) << -one.e);
+            return len;
+        }
+        pow10 /= 10;
+    }
+
+    int m = 0;
+    for (;;) {
+        p2 *= 10;
+        auto const d = static_cast<char>(p2 >> -one.e);
+        p2 &= one.f - 1;
+        buf[len++] = static_cast<char>('0' + d);
+        m++;
+        delta *= 10;
+        dist *= 10;
+        if (p2 <= delta) {
+            break;
+        }
+    }
+    decimal_exponent -= m;
+    grisu2_round(buf, len, dist, delta, p2, one.f);
+    return len;
+}
+
+// writes the shortest digits d1...dn of a finite, positive value so that
+// d1...dn * 10^decimal_exponent rounds to value.
+template <typename float_t>
+int grisu2(char *buf, int &decimal_exponent, float_t value) noexcept {
+    float_boundaries const b = compute_boundaries(value);
+    cached_power const cached = get_cached_power(b.plus.e);
+    diy_fp const c_minus_k{cached.f, cached.e};
+
+    diy_fp const w = diy_fp::mul(b.w, c_minus_k);
+    diy_fp const w_minus = diy_fp::mul(b.minus, c_minus_k);
+    diy_fp const w_plus = diy_fp::mul(b.plus, c_minus_k);
+
+    // the products are only correct within one ulp, so the boundaries
+    // are narrowed accordingly
+    diy_fp const m_minus{w_minus.f + 1, w_minus.e};
+    diy_fp const m_plus{w_plus.f - 1, w_plus.e};
+
+    decimal_exponent = -cached.k;
+    return grisu2_digit_gen(buf, decimal_exponent, m_minus, w, m_plus);
+}
+
+inline char *place_exponent(char *buf, int e) noexcept {
+    *buf++ = 'e';
+    if (e < 0) {
+        e = -e;
+        *buf++ = '-';
+    } else {
+        *buf++ = '+';
+    }
+    // at least two exponent digits as printf does
+    if (e < 100) {
+        std::memcpy(buf, digits2 + e * 2, 2);
+        return buf + 2;
+    }
+    *buf++ = static_cast<char>('0' + e / 100);
+    std::memcpy(buf, digits2 + (e % 100) * 2, 2);
+    return buf + 2;
+}
+
+// special values as printed by printf
+inline char *place_non_finite(char *buf, bool negative, bool nan) noexcept {
+    if (negative) {
+        *buf++ = '-';
+    }
+    std::memcpy(buf, nan ? "nan" : "inf", 3);
+    return buf + 3;
+}
+
+// places a short representation that reads back as value (Grisu2).
+//
+// decimal notation is used for decimal exponents in [-4, max_digits),
+// scientific notation otherwise, e.g. 0.1, 1.0, 1234.5, 1e+300, 1.5e-07.
+template <typename float_t>
+char *place_shortest(char *buf, float_t value) noexcept {
+    using traits = float_traits<float_t>;
+    if (!(value == value) || value - value != 0) {
+        return place_non_finite(buf, std::signbit(value), value != value);
+    }
+    if (std::signbit(value)) {
+        *buf++ = '-';
+        value = -value;
+    }
+    if (value == 0) {
+        std::memcpy(buf, "0.0", 3);
+        return buf + 3;
+    }
+
+    char digits[32];
+    int decimal_exponent;
+    int const k = grisu2(digits, decimal_exponent, value);
+    // position of the decimal point relative to the first digit
+    int const n = k + decimal_exponent;
+
+    if (k <= n && n <= traits::max_digits) {
+        // digits followed by zeros: 1234000.0
+        std::memcpy(buf, digits, k);
+        std::memset(buf + k, '0', n - k);
+        buf += n;
+        std::memcpy(buf, ".0", 2);
+        return buf + 2;
+    }
+    if (0 < n && n <= traits::max_digits) {
+        // decimal point within the digits: 1234.5
+        std::memcpy(buf, digits, n);
+        buf[n] = '.';
+        std::memcpy(buf + n + 1, digits + n, k - n);
+        return buf + k + 1;
+    }
+    if (-4 < n && n <= 0) {
+        // leading zeros: 0.0012345
+        buf[0] = '0';
+        buf[1] = '.';
+        std::memset(buf + 2, '0', -n);
+        std::memcpy(buf + 2 - n, digits, k);
+        return buf + 2 - n + k;
+    }
+    // scientific notation: 1.2345e+300
+    *buf++ = digits[0];
+    if (k > 1) {
+        *buf++ = '.';
+        std::memcpy(buf, digits + 1, k - 1);
+        buf += k - 1;
+    }
+    return place_exponent(buf, n - 1);
+}
+
+// exact decimal digits of the integer m * 2^e for large exponents.
+// The number is kept in base 10^9 limbs.
+inline char *place_big_integer(char *buf, uint64_t m, int e) noexcept {
+    constexpr uint32_t limb_base = 1000000000;
+    // 10^309 needs 35 limbs
+    uint32_t limbs[36];
+    int used = 0;
+    while (m != 0) {
+        limbs[used++] = static_cast<uint32_t>(m % limb_base);
+        m /= limb_base;
+    }
+    while (e > 0) {
+        // limb * 2^28 + carry < 2^64
+        int const shift = e < 28 ? e : 28;
+        e -= shift;
+        uint64_t carry = 0;
+        for (int i = 0; i < used; ++i) {
+            uint64_t const v = (static_cast<uint64_t>(limbs[i]) << shift) + carry;
+            limbs[i] = static_cast<uint32_t>(v % limb_base);
+            carry = v / limb_base;
+        }
+        while (carry != 0) {
+            limbs[used++] = static_cast<uint32_t>(carry % limb_base);
+            carry /= limb_base;
+        }
+    }
+    buf = place_decimal(buf, limbs[used - 1]);
+    for (int i = used - 2; i >= 0; --i) {
+        *buf = static_cast<char>('0' + limbs[i] / 100000000);
+        place_decimal8(buf + 1, limbs[i] % 100000000);
+        buf += 9;
+    }
+    return buf;
+}
+
+// maximal precision supported by place_fixed.
+// 10^precision has to fit into 64-bit (see powers10_64), so
+// m * 10^precision fits into 128-bit.
+constexpr int max_fixed_precision = 19;
+
+static_assert(max_fixed_precision <
+              sizeof(powers10_64) / sizeof(powers10_64[0]));
+
+// places value in fixed notation with precision digits after
+// the decimal point.
+//
+// The output is identical to printf("%.*f", precision, value) in the
+// default rounding mode (round half to even on the exact binary value).
+template <typename float_t>
+char *place_fixed(char *buf, float_t value, int precision) noexcept {
+    using traits = float_traits<float_t>;
+    typename traits::bits_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    bool const negative = (bits >> (sizeof(bits) * 8 - 1)) != 0;
+    uint64_t const fraction = bits & (traits::hidden_bit - 1);
+    int const exponent =
+        (bits >> (traits::precision - 1)) & traits::exponent_mask;
+
+    if (exponent == traits::exponent_mask) {
+        return place_non_finite(buf, negative, fraction != 0);
+    }
+    if (negative) {
+        *buf++ = '-';
+    }
+
+    // value = m * 2^e
+    uint64_t const m =
+        exponent == 0 ? fraction : fraction + traits::hidden_bit;
+    int const e = exponent == 0 ? traits::min_exponent
+                                : exponent - traits::bias;
+
+    uint64_t const pow10 = powers10_64[precision] + (precision == 0);
+    uint64_t integral;
+    uint64_t decimals = 0;
+    if (e >= 0) {
+        // integral values have no decimals
+        if (e > 63 - traits::precision) {
+            buf = place_big_integer(buf, m, e);
+        } else {
+            buf = place_decimal(buf, m << e);
+        }
+        if (precision > 0) {
+            *buf = '.';
+            std::memset(buf + 1, '0', precision);
+            buf += precision + 1;
+        }
+        return buf;
+    } else {
+        int const s = -e;
+        uint64_t fractional;
+        if (s < 64) {
+            integral = m >> s;
+            fractional = m & ((uint64_t{1} << s) - 1);
+        } else {
+            integral = 0;
+            fractional = m;
+        }
+        // round(fractional / 2^s * 10^precision), ties to even
+        unsigned __int128 const scaled =
+            static_cast<unsigned __int128>(fractional) * pow10;
+        if (s < 128) {
+            decimals = static_cast<uint64_t>(scaled >> s);
+            unsigned __int128 const rest =
+                scaled - (static_cast<unsigned __int128>(decimals) << s);
+            unsigned __int128 const half = static_cast<unsigned __int128>(1)
+                                           << (s - 1);
+            bool const odd = precision == 0 ? (integral & 1) : (decimals & 1);
+            if (rest > half || (rest == half && odd)) {
+                decimals++;
+            }
+        }
+        if (decimals >= pow10) {
+            decimals -= pow10;
+            integral++;
+        }
+    }
+    buf = place_decimal(buf, integral);
+    if (precision > 0) {
+        *buf++ = '.';
+        char *end = buf + precision;
+        std::memset(buf, '0', precision);
+        if (decimals != 0) {
+            char digits[20];
+            char *digits_end = place_decimal(digits, decimals);
+            auto const l = digits_end - digits;
+            std::memcpy(end - l, digits, l);
+        }
+        buf = end;
+    }
+    return buf;
+}
+
+// exact upper bound of place_fixed for a type and a precision
+template <typename float_t>
+constexpr size_t fixed_placement_size(int precision) noexcept {
+    // sign, integral digits, decimal point, decimals
+    return 1 + float_traits<float_t>::max_integral_digits + 1 + precision;
+}
+
+// exact upper bound of place_shortest for a type
+template <typename float_t>
+constexpr size_t shortest_placement_size() noexcept {
+    constexpr int max_digits = float_traits<float_t>::max_digits;
+    constexpr int max_exponent_digits =
+        std::numeric_limits<float_t>::max_exponent10 >= 100 ? 3 : 2;
+    // sign, "0.000" and all digits
+    constexpr size_t leading_zeros = 1 + 5 + max_digits;
+    // sign, digits, decimal point, 'e', exponent sign, exponent
+    constexpr size_t scientific = 1 + max_digits + 1 + 2 + max_exponent_digits;
+    return leading_zeros > scientific ? leading_zeros : scientific;
+}
+
+}  // namespace internal
+
+}  // namespace placement
+
+}  // namespace pformat
@@ -0,0 +1,215 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+
+#if defined(__AVX2__) || defined(__SSSE3__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "integer.h"
+
+namespace pformat {
+
+namespace placement {
+
+namespace internal {
+
+// Hex conversion of byte ranges, see pformat::hexdump.
+//
+// The vector kernels split 16 (SSE) or 32 (AVX2) bytes into nibbles,
+// map them to digits with a table lookup (pshufb) or, with plain SSE2,
+// with a compare and add, and interleave the high and low digits.
+// Everything else takes two digits per byte from hex_digits2.
+
+#if defined(__SSSE3__) || defined(__SSE2__)
+// the hex digits of the 16 nibbles in x
+inline __m128i hex_digits(__m128i x) noexcept {
+#ifdef __SSSE3__
+    return _mm_shuffle_epi8(
+        _mm_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a',
+                      'b', 'c', 'd', 'e', 'f'),
+        x);
+#else
+    __m128i const letter = _mm_cmpgt_epi8(x, _mm_set1_epi8(9));
+    return _mm_add_epi8(
+        _mm_add_epi8(x, _mm_set1_epi8('0')),
+        _mm_and_si128(letter, _mm_set1_epi8('a' - '0' - 10)));
+#endif
+}
+
+// writes the 32 hex digits of 16 bytes
+inline void place_hex16(char *out, unsigned char const *in) noexcept {
+    __m128i const mask = _mm_set1_epi8(0x0f);
+    __m128i const v =
+        _mm_loadu_si128(reinterpret_cast<__m128i const *>(in));
+    __m128i const high =
+        hex_digits(_mm_and_si128(_mm_srli_epi16(v, 4), mask));
+    __m128i const low = hex_digits(_mm_and_si128(v, mask));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out),
+                     _mm_unpacklo_epi8(high, low));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 16),
+                     _mm_unpackhi_epi8(high, low));
+}
+#else
+inline void place_hex16(char *out, unsigned char const *in) noexcept {
+    for (size_t i = 0; i < 16; ++i) {
+        std::memcpy(out + 2 * i, hex_digits2.digits + 2 * in[i], 2);
+    }
+}
+#endif
+
+#ifdef __AVX2__
+// writes the 64 hex digits of 32 bytes
+inline void place_hex32(char *out, unsigned char const *in) noexcept {
+    __m256i const digits = _mm256_setr_epi8(
+        '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd',
+        'e', 'f', '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b',
+        'c', 'd', 'e', 'f');
+    __m256i const mask = _mm256_set1_epi8(0x0f);
+    __m256i const v =
+        _mm256_loadu_si256(reinterpret_cast<__m256i const *>(in));
+    __m256i const high = _mm256_shuffle_epi8(
+        digits, _mm256_and_si256(_mm256_srli_epi16(v, 4), mask));
+    __m256i const low =
+        _mm256_shuffle_epi8(digits, _mm256_and_si256(v, mask));
+    // the unpacks work within 128-bit lanes, the permutes restore the
+    // byte order
+    __m256i const a = _mm256_unpacklo_epi8(high, low);
+    __m256i const b = _mm256_unpackhi_epi8(high, low);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out),
+                        _mm256_permute2x128_si256(a, b, 0x20));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + 32),
+                        _mm256_permute2x128_si256(a, b, 0x31));
+}
+#endif
+
+// writes the 2 * size hex digits of the bytes
+inline char *place_hex_bytes(char *out, unsigned char const *in,
+                             size_t size) noexcept {
+#ifdef __AVX2__
+    for (; size >= 32; size -= 32, in += 32, out += 64) {
+        place_hex32(out, in);
+    }
+#endif
+    for (; size >= 16; size -= 16, in += 16, out += 32) {
+        place_hex16(out, in);
+    }
+    for (; size > 0; --size, ++in, out += 2) {
+        std::memcpy(out, hex_digits2.digits + 2 * *in, 2);
+    }
+    return out;
+}
+
+// place_hexdump for a group size of group_t, either a size_t or an
+// integral_constant, so common group sizes get constant-size copies
+template <typename group_t>
+inline char *place_hex_groups(char *out, unsigned char const *in,
+                              size_t size, group_t group) noexcept {
+    size_t i = 0;
+    if (group < 16) {
+        // the digits of as many whole groups as fit into 16 bytes are
+        // converted at once and then copied group by group
+        size_t const block = 16 / group * group;
+        char digits[32];
+        for (; size - i >= 16 && size - i > block; i += block) {
+            place_hex16(digits, in + i);
+            for (size_t g = 0; g < block; g += group) {
+                std::memcpy(out, digits + 2 * g, 2 * group);
+                out[2 * group] = ' ';
+                out += 2 * group + 1;
+            }
+        }
+    }
+    for (; size - i > group; i += group) {
+        out = place_hex_bytes(out, in + i, group);
+        *out++ = ' ';
+    }
+    return place_hex_bytes(out, in + i, size - i);
+}
+
+// writes the hex digits of the bytes with a space after every group
+// bytes, except after the last byte. group 0 places no spaces.
+inline char *place_hexdump(char *out, unsigned char const *in, size_t size,
+                           size_t group) noexcept {
+    if (group == 0 || group >= size) {
+        return place_hex_bytes(out, in, size);
+    }
+    switch (group) {
+        case 1:
+            return place_hex_groups(out, in, size,
+                                    std::integral_constant<size_t, 1>());
+        case 2:
+            return place_hex_groups(out, in, size,
+                                    std::integral_constant<size_t, 2>());
+        case 4:
+            return place_hex_groups(out, in, size,
+                                    std::integral_constant<size_t, 4>());
+        case 8:
+            return place_hex_groups(out, in, size,
+                                    std::integral_constant<size_t, 8>());
+        default:
+            return place_hex_groups(out, in, size, group);
+    }
+}
+
+}  // namespace internal
+
+// wrapper to place bytes as hex digits, see pformat::hexdump
+struct hex_bytes {
+    unsigned char const *data;
+    size_t size;
+    // bytes per group, groups are separated by a space. 0 places no
+    // spaces.
+    size_t group;
+};
+
+inline char *unsafe_place(char *buf, hex_bytes const &v) noexcept {
+    return internal::place_hexdump(buf, v.data, v.size, v.group);
+}
+
+// the exact size: two digits per byte and a space between groups
+inline size_t placement_size(hex_bytes const &v) noexcept {
+    if (v.size == 0) {
+        return 0;
+    }
+    return 2 * v.size + (v.group == 0 ? 0 : (v.size - 1) / v.group);
+}
+
+inline size_t exact_size(hex_bytes const &v) noexcept {
+    return placement_size(v);
+}
+
+}  // namespace placement
+
+/**
+ * places size bytes at data as lowercase hex digits, two per byte.
+ *
+ * With a group size, a space separates every group bytes, e.g.
+ * hexdump(data, 6, 2) places "0a1b 2c3d 4e5f". The bytes are read when
+ * they are placed, they have to stay valid until then.
+ */
+inline placement::hex_bytes hexdump(void const *data, size_t size,
+                                    size_t group = 0) noexcept {
+    return {static_cast<unsigned char const *>(data), size, group};
+}
+
+/**
+ * places the bytes of a contiguous range of byte-sized elements, e.g.
+ * a std::string_view, a std::vector<uint8_t> or a
+ * std::array<std::byte, n>.
+ */
+template <typename range_t,
+          typename std::enable_if<
+              sizeof(*std::declval<range_t const &>().data()) == 1>::type * =
+              nullptr>
+placement::hex_bytes hexdump(range_t const &bytes, size_t group = 0) noexcept {
+    return hexdump(bytes.data(), bytes.size(), group);
+}
+
+}  // namespace pformat
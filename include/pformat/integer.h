@@ -0,0 +1,191 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+namespace pformat {
+
+namespace placement {
+
+namespace internal {
+
+// two ASCII digits for each value in [0, 100)
+inline constexpr char digits2[] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+// two hex digits for each value in [0, 256)
+struct hex_digits2_table {
+    char digits[512] = {};
+
+    constexpr explicit hex_digits2_table(char const *hex) noexcept {
+        for (unsigned i = 0; i < 256; ++i) {
+            digits[2 * i] = hex[i >> 4];
+            digits[2 * i + 1] = hex[i & 0xf];
+        }
+    }
+};
+inline constexpr hex_digits2_table hex_digits2{"0123456789abcdef"};
+inline constexpr hex_digits2_table hex_digits2_upper{"0123456789ABCDEF"};
+
+inline constexpr uint32_t powers10_32[] = {
+    0,         10,        100,        1000,      10000,
+    100000,    1000000,   10000000,   100000000, 1000000000};
+
+inline constexpr uint64_t powers10_64[] = {
+    0ULL,
+    10ULL,
+    100ULL,
+    1000ULL,
+    10000ULL,
+    100000ULL,
+    1000000ULL,
+    10000000ULL,
+    100000000ULL,
+    1000000000ULL,
+    10000000000ULL,
+    100000000000ULL,
+    1000000000000ULL,
+    10000000000000ULL,
+    100000000000000ULL,
+    1000000000000000ULL,
+    10000000000000000ULL,
+    100000000000000000ULL,
+    1000000000000000000ULL,
+    10000000000000000000ULL};
+
+// number of decimal digits of value.
+//
+// log10 is approximated from the bit length (1233 / 4096 ~ log10(2)) and
+// corrected with a single table lookup.
+inline int count_digits(uint32_t value) noexcept {
+    int t = ((32 - __builtin_clz(value | 1)) * 1233) >> 12;
+    return t - (value < powers10_32[t]) + 1;
+}
+
+inline int count_digits(uint64_t value) noexcept {
+    int t = ((64 - __builtin_clzll(value | 1)) * 1233) >> 12;
+    return t - (value < powers10_64[t]) + 1;
+}
+
+// number of hex digits of value
+inline int count_hex_digits(uint32_t value) noexcept {
+    return (32 - __builtin_clz(value | 1) + 3) >> 2;
+}
+
+inline int count_hex_digits(uint64_t value) noexcept {
+    return (64 - __builtin_clzll(value | 1) + 3) >> 2;
+}
+
+// writes the decimal digits of value backwards, ending at end.
+//
+// the digits are written two at a time into their final position,
+// so no reversing is needed.
+inline void place_decimal_backwards(char *end, uint32_t value) noexcept {
+    char *p = end;
+    while (value >= 100) {
+        auto const i = (value % 100) * 2;
+        value /= 100;
+        p -= 2;
+        std::memcpy(p, digits2 + i, 2);
+    }
+    if (value < 10) {
+        *--p = static_cast<char>('0' + value);
+    } else {
+        std::memcpy(p - 2, digits2 + value * 2, 2);
+    }
+}
+
+// writes exactly 8 decimal digits (with leading zeros) of value < 10^8
+inline void place_decimal8(char *buf, uint32_t value) noexcept {
+    uint32_t const high = value / 10000;
+    uint32_t const low = value % 10000;
+    std::memcpy(buf, digits2 + (high / 100) * 2, 2);
+    std::memcpy(buf + 2, digits2 + (high % 100) * 2, 2);
+    std::memcpy(buf + 4, digits2 + (low / 100) * 2, 2);
+    std::memcpy(buf + 6, digits2 + (low % 100) * 2, 2);
+}
+
+inline char *place_decimal(char *buf, uint32_t value) noexcept {
+    char *end = buf + count_digits(value);
+    place_decimal_backwards(end, value);
+    return end;
+}
+
+// 64-bit divisions are noticeable slower than 32-bit divisions,
+// so 64-bit values are split into 8 digit chunks handled in 32-bit.
+inline char *place_decimal(char *buf, uint64_t value) noexcept {
+    if (value <= std::numeric_limits<uint32_t>::max()) {
+        return place_decimal(buf, static_cast<uint32_t>(value));
+    }
+    char *end = buf + count_digits(value);
+    char *p = end;
+    do {
+        p -= 8;
+        place_decimal8(p, static_cast<uint32_t>(value % 100000000));
+        value /= 100000000;
+    } while (value > std::numeric_limits<uint32_t>::max());
+    place_decimal_backwards(p, static_cast<uint32_t>(value));
+    return end;
+}
+
+template <bool upper = false, typename uint_t>
+inline char *place_hex(char *buf, uint_t value, int digits) noexcept {
+    constexpr hex_digits2_table const &hex_digits2 =
+        upper ? internal::hex_digits2_upper : internal::hex_digits2;
+    char *p = buf + digits;
+    while (value >= 0x100) {
+        auto const i = static_cast<unsigned>(value & 0xff) * 2;
+        value >>= 8;
+        p -= 2;
+        std::memcpy(p, hex_digits2.digits + i, 2);
+    }
+    if (value < 0x10) {
+        *--p = hex_digits2.digits[value * 2 + 1];
+    } else {
+        std::memcpy(p - 2, hex_digits2.digits + value * 2, 2);
+    }
+    return buf + digits;
+}
+
+template <bool upper = false>
+inline char *place_hex(char *buf, uint32_t value) noexcept {
+    return place_hex<upper>(buf, value, count_hex_digits(value));
+}
+
+template <bool upper = false>
+inline char *place_hex(char *buf, uint64_t value) noexcept {
+    return place_hex<upper>(buf, value, count_hex_digits(value));
+}
+
+// maximal number of characters of an integer of type int_t placed
+// in decimal, including the sign
+template <typename int_t>
+constexpr size_t max_decimal_size() noexcept {
+    return std::numeric_limits<int_t>::digits10 + 1 +
+           std::numeric_limits<int_t>::is_signed;
+}
+
+static_assert(max_decimal_size<int8_t>() == 4);     // -128
+static_assert(max_decimal_size<uint8_t>() == 3);    // 255
+static_assert(max_decimal_size<int32_t>() == 11);   // -2147483648
+static_assert(max_decimal_size<uint64_t>() == 20);  // 18446744073709551615
+
+// the kernel width for an integer type:
+// 8, 16 and 32-bit integers share the 32-bit kernel
+template <typename int_t>
+using kernel_uint_t =
+    typename std::conditional<(sizeof(int_t) <= sizeof(uint32_t)), uint32_t,
+                              uint64_t>::type;
+
+}  // namespace internal
+
+}  // namespace placement
+
+}  // namespace pformat
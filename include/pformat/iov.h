@@ -0,0 +1,173 @@
+#pragma once
+
+#include <sys/uio.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace pformat {
+
+/**
+ * Output of log_config::format_iov: a list of segments to be written
+ * with writev.
+ *
+ * A segment either references memory of the caller, e.g. a large string
+ * argument or a literal of the format string, or a part of the scratch
+ * memory of the builder, into which all other output is placed.
+ * Adjacent scratch parts are merged into one segment.
+ *
+ * Referenced memory has to stay valid until the segments are written.
+ * The scratch memory is kept across clear(), so reusing a builder does
+ * not allocate.
+ */
+class iov_builder {
+   public:
+    // strings of at least this many characters are referenced. Below
+    // that a copy is cheaper than an additional segment.
+    static constexpr size_t default_reference_threshold = 4096;
+
+    // size of a scratch block, larger outputs get their own block
+    static constexpr size_t scratch_block_size = 4096;
+
+    explicit iov_builder(
+        size_t reference_threshold_ = default_reference_threshold)
+        : threshold(reference_threshold_) {}
+
+    size_t reference_threshold() const noexcept { return threshold; }
+
+    iovec const *data() const noexcept { return segments.data(); }
+
+    // number of segments
+    size_t size() const noexcept { return segments.size(); }
+
+    // number of characters in all segments
+    size_t bytes() const noexcept {
+        size_t n = 0;
+        for (auto const &s : segments) {
+            n += s.iov_len;
+        }
+        return n;
+    }
+
+    // removes all segments, keeps the scratch memory
+    void clear() noexcept {
+        segments.clear();
+        current = 0;
+        used = 0;
+    }
+
+    // adds a segment referencing size characters at data
+    void reference(char const *data, size_t size) {
+        if (size > 0) {
+            segments.push_back({const_cast<char *>(data), size});
+        }
+    }
+
+    // returns scratch memory for at least size characters. The used part
+    // has to be added with commit, it stays valid until clear().
+    char *scratch(size_t size) {
+        while (current < blocks.size() &&
+               blocks[current].capacity - used < size) {
+            current++;
+            used = 0;
+        }
+        if (current == blocks.size()) {
+            size_t const capacity = std::max(size, scratch_block_size);
+            blocks.push_back({std::make_unique<char[]>(capacity), capacity});
+            used = 0;
+        }
+        return blocks[current].data.get() + used;
+    }
+
+    // adds the scratch memory [begin, end) returned by scratch as a
+    // segment
+    void commit(char const *begin, char const *end) {
+        if (begin == end) {
+            return;
+        }
+        used = end - blocks[current].data.get();
+        if (!segments.empty()) {
+            iovec &last = segments.back();
+            if (static_cast<char const *>(last.iov_base) + last.iov_len ==
+                begin) {
+                last.iov_len += end - begin;
+                return;
+            }
+        }
+        reference(begin, end - begin);
+    }
+
+    // the concatenation of all segments
+    std::string str() const {
+        std::string s;
+        s.reserve(bytes());
+        for (auto const &segment : segments) {
+            s.append(static_cast<char const *>(segment.iov_base),
+                     segment.iov_len);
+        }
+        return s;
+    }
+
+    /**
+     * Writes all segments to the file descriptor with as few writev
+     * calls as possible.
+     *
+     * returns 0 and clears the builder on success. Otherwise returns the
+     * errno of the failed writev, the builder then only holds what was
+     * not written.
+     */
+    int write_to(int fd) {
+#ifdef IOV_MAX
+        constexpr size_t max_segments = IOV_MAX;
+#else
+        constexpr size_t max_segments = 1024;
+#endif
+        size_t i = 0;
+        while (i < segments.size()) {
+            ssize_t written =
+                ::writev(fd, segments.data() + i,
+                         std::min(segments.size() - i, max_segments));
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                int const error = errno;
+                segments.erase(segments.begin(), segments.begin() + i);
+                return error;
+            }
+            while (i < segments.size() &&
+                   static_cast<size_t>(written) >= segments[i].iov_len) {
+                written -= segments[i].iov_len;
+                i++;
+            }
+            if (written > 0) {
+                segments[i].iov_base =
+                    static_cast<char *>(segments[i].iov_base) + written;
+                segments[i].iov_len -= written;
+            }
+        }
+        clear();
+        return 0;
+    }
+
+   private:
+    struct block {
+        std::unique_ptr<char[]> data;
+        size_t capacity;
+    };
+
+    size_t const threshold;
+    std::vector<iovec> segments;
+    std::vector<block> blocks;
+    // the scratch block in use and its used characters
+    size_t current = 0;
+    size_t used = 0;
+};
+
+}  // namespace pformat
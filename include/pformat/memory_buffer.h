@@ -0,0 +1,129 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+namespace pformat {
+
+/**
+ * growable character buffer with inline storage for the first
+ * inline_capacity characters.
+ *
+ * Used as output of log_config::format_append. Small outputs never
+ * touch the heap, larger outputs grow the buffer geometrically, so
+ * appending many messages needs only a logarithmic number of
+ * allocations. The buffer is not zero terminated.
+ */
+template <size_t inline_capacity>
+class basic_memory_buffer {
+    char *ptr = inline_storage;
+    size_t internal_size = 0;
+    size_t internal_capacity = inline_capacity;
+    char inline_storage[inline_capacity];
+
+    bool is_inline() const noexcept { return ptr == inline_storage; }
+
+    // moves the content into a heap allocation of at least
+    // new_capacity characters
+    void grow(size_t new_capacity) {
+        new_capacity = std::max(new_capacity, 2 * internal_capacity);
+        char *p = new char[new_capacity];
+        std::memcpy(p, ptr, internal_size);
+        if (!is_inline()) {
+            delete[] ptr;
+        }
+        ptr = p;
+        internal_capacity = new_capacity;
+    }
+
+   public:
+    basic_memory_buffer() noexcept = default;
+
+    basic_memory_buffer(basic_memory_buffer const &other) {
+        append(other.view());
+    }
+
+    basic_memory_buffer(basic_memory_buffer &&other) noexcept {
+        *this = std::move(other);
+    }
+
+    basic_memory_buffer &operator=(basic_memory_buffer const &other) {
+        if (this != &other) {
+            clear();
+            append(other.view());
+        }
+        return *this;
+    }
+
+    basic_memory_buffer &operator=(basic_memory_buffer &&other) noexcept {
+        if (this == &other) {
+            return *this;
+        }
+        if (!is_inline()) {
+            delete[] ptr;
+        }
+        if (other.is_inline()) {
+            ptr = inline_storage;
+            internal_capacity = inline_capacity;
+            std::memcpy(ptr, other.ptr, other.internal_size);
+        } else {
+            // take over the heap allocation
+            ptr = other.ptr;
+            internal_capacity = other.internal_capacity;
+            other.ptr = other.inline_storage;
+            other.internal_capacity = inline_capacity;
+        }
+        internal_size = other.internal_size;
+        other.internal_size = 0;
+        return *this;
+    }
+
+    ~basic_memory_buffer() {
+        if (!is_inline()) {
+            delete[] ptr;
+        }
+    }
+
+    char *data() noexcept { return ptr; }
+    char const *data() const noexcept { return ptr; }
+    size_t size() const noexcept { return internal_size; }
+    size_t capacity() const noexcept { return internal_capacity; }
+    char const *begin() const noexcept { return ptr; }
+    char const *end() const noexcept { return ptr + internal_size; }
+
+    std::string_view view() const noexcept { return {ptr, internal_size}; }
+    std::string str() const { return std::string(ptr, internal_size); }
+
+    // ensures a capacity of at least new_capacity characters.
+    // Grows at least by a factor of two.
+    void reserve(size_t new_capacity) {
+        if (new_capacity > internal_capacity) {
+            grow(new_capacity);
+        }
+    }
+
+    // sets the size, e.g. after writing into data().
+    // New characters are not initialized.
+    void resize(size_t size) {
+        reserve(size);
+        internal_size = size;
+    }
+
+    // keeps the capacity and the heap allocation
+    void clear() noexcept { internal_size = 0; }
+
+    void append(std::string_view s) {
+        reserve(internal_size + s.size());
+        std::memcpy(ptr + internal_size, s.data(), s.size());
+        internal_size += s.size();
+    }
+};
+
+// memory_buffer with as much inline storage as log_config::format
+// uses on the stack
+using memory_buffer = basic_memory_buffer<500>;
+
+}  // namespace pformat
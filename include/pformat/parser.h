@@ -10,27 +10,24 @@
 #include <vector>
 
 #include "fixed_string.h"
+#include "spec.h"
 
 namespace pformat {
 
 namespace internal {
 
-struct state_in {};
-struct state_out {};
-struct state_out_escape {};
-
 enum class format_type { PARAMETER, ELEMENT };
 
-// format element copying a substring of the grammer to the output
+// format element copying a substring of the literal pool to the output
 template <size_t start_v, size_t end_v>
 struct format_element {
     static constexpr auto type = format_type::ELEMENT;
 
     static constexpr size_t size() noexcept { return s; }
 
-    // offset into the grammer string
+    // offset into the literal pool
     constexpr static size_t start = start_v;
-    // end offset within the grammer string
+    // end offset within the literal pool
     constexpr static size_t end = end_v;
 
    private:
@@ -38,14 +35,43 @@ struct format_element {
 };
 
 // format based on a parameter
-template <size_t i>
+//
+// spec_t: spec_constant with the format spec of the parameter
+// name_start_v, name_end_v: offsets of the name of a named parameter,
+// e.g. {page_id}, within the format string. Equal for unnamed ones.
+template <size_t i, typename spec_t = default_spec, size_t name_start_v = 0,
+          size_t name_end_v = 0>
 struct format_parameter {
     static constexpr auto type = format_type::PARAMETER;
     constexpr static size_t index = i;
+    using spec = spec_t;
+    constexpr static size_t name_start = name_start_v;
+    constexpr static size_t name_end = name_end_v;
+
+    static constexpr bool is_named() noexcept {
+        return name_start != name_end;
+    }
+};
+
+// std::tuple<spec> for a format_parameter, std::tuple<> otherwise
+template <typename element_t>
+struct parameter_spec_list {
+    using type = std::tuple<>;
+};
+
+template <size_t i, typename spec_t, size_t name_start, size_t name_end>
+struct parameter_spec_list<
+    format_parameter<i, spec_t, name_start, name_end>> {
+    using type = std::tuple<spec_t>;
 };
 
 // result of a format parsing
-template <std::string_view const &grammer_str, typename... element_t>
+//
+// grammer_str: the format string
+// literal_str: the literal pool, i.e. the literal text of the format string
+// without escapes. The format elements refer to it.
+template <std::string_view const &grammer_str,
+          std::string_view const &literal_str, typename... element_t>
 struct format_result {
     // returns true iff this is a valid formatting string
     static constexpr bool is_valid_format_string() noexcept {
@@ -53,13 +79,49 @@ struct format_result {
     }
 
     // returns the number of parameters
-    static constexpr auto get_parameter_count() noexcept {
-        size_t count{};
-        visit([](auto) {}, [&count](auto) { count++; });
-        return count;
+    static constexpr size_t get_parameter_count() noexcept {
+        return (size_t{} + ... +
+                (element_t::type == format_type::PARAMETER ? 1 : 0));
     }
 
-    static std::string_view const &str() noexcept { return grammer_str; }
+    // returns the number of characters of all format elements
+    static constexpr size_t get_element_size() noexcept {
+        return (size_t{} + ... + element_size<element_t>());
+    }
+
+    // returns the number of format elements and parameters
+    static constexpr size_t get_segment_count() noexcept {
+        return sizeof...(element_t);
+    }
+
+    static constexpr std::string_view const &str() noexcept {
+        return grammer_str;
+    }
+
+    static constexpr std::string_view const &literals() noexcept {
+        return literal_str;
+    }
+
+    // the name of a named parameter, empty for unnamed ones
+    template <typename parameter_t>
+    static constexpr std::string_view name() noexcept {
+        return grammer_str.substr(parameter_t::name_start,
+                                  parameter_t::name_end -
+                                      parameter_t::name_start);
+    }
+
+    // returns the number of named parameters
+    static constexpr size_t get_named_parameter_count() noexcept {
+        return (size_t{} + ... + (is_named<element_t>() ? 1 : 0));
+    }
+
+    // the spec_constant types of the parameters in index order
+    using parameter_specs = decltype(std::tuple_cat(
+        std::declval<typename parameter_spec_list<element_t>::type>()...));
+
+    // the spec_constant of the parameter with index i
+    template <size_t i>
+    using parameter_spec_t = std::tuple_element_t<i, parameter_specs>;
 
     // the visit function using the visitor pattern
     // is the main way inspect the format result.
@@ -67,27 +129,35 @@ struct format_result {
     inline static constexpr void visit(element_func_t &&ev,
                                        parameter_func_t &&pv) {
         static_assert(is_valid_format_string());
-        visit_helper<element_func_t, parameter_func_t, element_t...>(
-            std::forward<element_func_t>(ev),
-            std::forward<parameter_func_t>(pv));
+        (visit_one<element_t>(ev, pv), ...);
     }
 
    private:
-    template <typename ev_t, typename pv_t, typename first_t,
-              typename... rest_t>
-    inline static constexpr void visit_helper(ev_t &&ev, pv_t &&pv) {
+    template <typename first_t, typename ev_t, typename pv_t>
+    inline static constexpr void visit_one(ev_t &ev, pv_t &pv) {
         if constexpr (first_t::type == format_type::PARAMETER) {
             pv(first_t{});
         } else {
             ev(first_t{});
         }
-        visit_helper<ev_t, pv_t, rest_t...>(std::forward<ev_t>(ev),
-                                            std::forward<pv_t>(pv));
     }
 
-    template <typename ev_t, typename pv_t>
-    inline static constexpr void visit_helper(ev_t &&, pv_t &&) {
-        return;
+    template <typename first_t>
+    static constexpr bool is_named() noexcept {
+        if constexpr (first_t::type == format_type::PARAMETER) {
+            return first_t::is_named();
+        } else {
+            return false;
+        }
+    }
+
+    template <typename first_t>
+    static constexpr size_t element_size() noexcept {
+        if constexpr (first_t::type == format_type::PARAMETER) {
+            return 0;
+        } else {
+            return first_t::size();
+        }
     }
 };
 
@@ -102,76 +172,203 @@ struct grammer_str {
         grammer_str<charpack...>::fixed_str.view()};
 };
 
-// grammer for parsing
+// a format element or parameter found by scan_format
+struct scanned_segment {
+    bool is_parameter;
+    // element: offsets within the literal pool
+    size_t start;
+    size_t end;
+    // parameter: index, format spec and the offsets of the name within
+    // the format string
+    size_t index;
+    format_spec spec;
+    size_t name_start;
+    size_t name_end;
+};
+
+// the segments and the literal pool of a format string.
 //
-// grammer_str: reference to a grammer_str instance
-// n: current offset in the grammer string
-// start_stack: start of next "format_element"
-// pc: number of format_parameter elements
-// result_t: format_element/format_parameter types, which is
-// form the mainresult of the grammer 'execution'.
-template <std::string_view const &grammer_str, int n, int start_stack, int pc,
-          typename... result_t>
-struct grammer {
-    // calculate the next format_result type
-
-    // current state: within a format parameter
-    static constexpr auto next(state_in) {
-        constexpr auto c = grammer_str[n];
-        if constexpr (c == '}') {  // } -> add format_parameter, move out
-            return grammer<grammer_str, n + 1, n + 1, pc + 1, result_t...,
-                           format_parameter<pc>>::next(state_out());
-        } else if constexpr (c == '{') {
-            // {{ escape
-            return grammer<grammer_str, n + 1, n, pc, result_t...>::next(
-                state_out());
-        } else {
-            // invalid
-            return format_result<grammer_str>();
-        }
+// max_size: upper bound on the number of segments and literal characters
+template <size_t max_size>
+struct scanned_format {
+    bool valid = false;
+    size_t count = 0;
+    scanned_segment segments[max_size] = {};
+    size_t literal_size = 0;
+    char literals[max_size] = {};
+
+    constexpr void add_parameter(size_t index, format_spec const &spec,
+                                 size_t name_start,
+                                 size_t name_end) noexcept {
+        segments[count++] = {true, 0, 0, index, spec, name_start, name_end};
     }
 
-    // current state: outside a format parameter
-    static constexpr auto next(state_out) {
-        constexpr auto c = grammer_str[n];
-
-        if constexpr (c == '{' && start_stack != n) {
-            using next_element_t = format_element<start_stack, n>;
-            return grammer<grammer_str, n + 1, n, pc, result_t...,
-                           next_element_t>::next(state_in());
-        } else if constexpr (c == '{') {
-            return grammer<grammer_str, n + 1, n, pc, result_t...>::next(
-                state_in());
-        } else if constexpr (c == '}') {  // maybe an escape {{}}?
-            return grammer<grammer_str, n + 1, start_stack, pc,
-                           result_t...>::next(state_out_escape());
-        } else if constexpr (c == 0 && start_stack != n) {
-            using next_element_t = format_element<start_stack, n>;
-            return format_result<grammer_str, result_t..., next_element_t>();
-        } else if constexpr (c == 0) {
-            // end of string
-            return format_result<grammer_str, result_t...>();
+    // appends the literal text [begin, end) of str.
+    // Adjacent literal text is merged into a single element.
+    constexpr void add_literal(char const *str, size_t begin,
+                               size_t end) noexcept {
+        if (begin == end) {
+            return;
+        }
+        size_t const start = literal_size;
+        for (size_t i = begin; i < end; ++i) {
+            literals[literal_size++] = str[i];
+        }
+        if (count > 0 && !segments[count - 1].is_parameter) {
+            segments[count - 1].end = literal_size;
         } else {
-            return grammer<grammer_str, n + 1, start_stack, pc,
-                           result_t...>::next(state_out());
+            segments[count++] = {false, start, literal_size, 0, {}, 0, 0};
         }
     }
+};
+
+constexpr bool is_name_start(char c) noexcept {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
 
-    // outside a format parameter
-    static constexpr auto next(state_out_escape) {
-        constexpr auto c = grammer_str[n];
-        if constexpr (c == '}') {
-            // closed the escape }}
-            using next_element_t = format_element<start_stack, n>;
-            return grammer<grammer_str, n + 1, n + 1, pc, result_t...,
-                           next_element_t>::next(state_out());
+constexpr bool is_name_char(char c) noexcept {
+    return is_name_start(c) || (c >= '0' && c <= '9');
+}
+
+// scans a zero terminated format string of length size in a single pass.
+//
+// "{{" and "}}" are escapes for "{" and "}". The literal text between
+// two parameters becomes a single element of the literal pool.
+// A parameter may be named, e.g. {page_id} or {page_id:08x}. Names are
+// identifiers and only used as keys of structured output, the
+// arguments are still taken in order.
+template <size_t max_size>
+constexpr scanned_format<max_size> scan_format(char const *str,
+                                               size_t size) noexcept {
+    scanned_format<max_size> result;
+    size_t start = 0;
+    size_t parameter_count = 0;
+    size_t n = 0;
+    while (n < size) {
+        char const c = str[n];
+        if (c == '{' && str[n + 1] == '{') {
+            // keep the second { as start of the next literal
+            result.add_literal(str, start, n);
+            start = n + 1;
+            n += 2;
+        } else if (c == '{') {
+            result.add_literal(str, start, n);
+            format_spec spec{};
+            size_t const name_start = n + 1;
+            if (is_name_start(str[n + 1])) {
+                do {
+                    n++;
+                } while (is_name_char(str[n + 1]));
+            }
+            size_t const name_end = n + 1;
+            if (str[n + 1] == '}') {
+                n += 2;
+            } else if (str[n + 1] == ':') {
+                auto const parsed = parse_spec(str, n + 2);
+                if (!parsed.valid) {
+                    return {};
+                }
+                spec = parsed.spec;
+                n = parsed.end + 1;
+            } else {
+                return {};
+            }
+            result.add_parameter(parameter_count++, spec, name_start,
+                                 name_end);
+            start = n;
+        } else if (c == '}') {
+            if (str[n + 1] != '}') {
+                return {};
+            }
+            // the literal ends after the first }
+            result.add_literal(str, start, n + 1);
+            start = n + 2;
+            n += 2;
         } else {
-            // we expect the closing '} here => not a valid format string
-            return format_result<grammer_str>();
+            n++;
         }
     }
+    result.add_literal(str, start, size);
+    result.valid = true;
+    return result;
+}
+
+static_assert(scan_format<16>("a{{b}}c{}", 9).count == 2);
+static_assert(scan_format<16>("a{{b}}c{}", 9).literal_size == 5);
+static_assert(scan_format<16>("a{{b}}c{}", 9).segments[0].end == 5);
+static_assert(scan_format<16>("{}{}", 4).count == 2);
+static_assert(scan_format<16>("{a}", 3).valid);
+static_assert(scan_format<16>("x{ab:>4}", 8).segments[1].name_start == 2);
+static_assert(scan_format<16>("x{ab:>4}", 8).segments[1].name_end == 4);
+static_assert(!scan_format<16>("{1a}", 4).valid);
+static_assert(!scan_format<16>("{a b}", 5).valid);
+
+// the format_element or format_parameter type of the scanned segment i
+// of scanned_t::scanned.
+//
+// The segment is read here rather than passed as a reference, a
+// reference to an array element is no valid template argument in C++17.
+template <typename scanned_t, size_t i>
+struct segment_type {
+    static constexpr scanned_segment segment = scanned_t::scanned.segments[i];
+    using type = typename std::conditional<
+        segment.is_parameter,
+        format_parameter<
+            segment.index,
+            spec_constant<segment.spec.fill, segment.spec.align,
+                          segment.spec.zero, segment.spec.type,
+                          segment.spec.width, segment.spec.precision>,
+            segment.name_start, segment.name_end>,
+        format_element<segment.start, segment.end>>::type;
+};
+
+template <typename scanned_t, size_t i>
+using segment_type_t = typename segment_type<scanned_t, i>::type;
+
+// copies the literal pool of a scanned format into an exactly
+// sized fixed string
+template <size_t N, typename scanned_t>
+constexpr fixed_string<N> make_literal_pool(scanned_t const &scanned) {
+    fixed_string<N> pool;
+    for (size_t i = 0; i < scanned.literal_size; ++i) {
+        pool.data()[i] = scanned.literals[i];
+    }
+    pool.resize(scanned.literal_size);
+    return pool;
+}
+
+// the scanned segments and the literal pool of a grammer string.
+//
+// Only the literal pool is referenced at runtime.
+template <std::string_view const &str>
+struct scanned_grammer {
+    static constexpr auto scanned =
+        scan_format<str.size() + 1>(str.data(), str.size());
+    constexpr static auto fixed_literals =
+        make_literal_pool<scanned.literal_size + 1>(scanned);
+    constexpr static std::string_view literals{fixed_literals.view()};
 };
 
+template <std::string_view const &str, size_t... i>
+constexpr auto make_format_result(std::index_sequence<i...>) {
+    using scanned_t = scanned_grammer<str>;
+    return format_result<str, scanned_t::literals,
+                         segment_type_t<scanned_t, i>...>();
+}
+
+// parses the zero terminated format string str, see parse_format
+template <std::string_view const &str>
+constexpr auto parse_format_string() {
+    if constexpr (str.size() == 0) {
+        return format_result<str, str, format_element<0, 0>>();
+    } else if constexpr (!scanned_grammer<str>::scanned.valid) {
+        return format_result<str, str>();
+    } else {
+        return make_format_result<str>(
+            std::make_index_sequence<scanned_grammer<str>::scanned.count>());
+    }
+}
+
 // parses the charpack
 //
 // returns a matching configured log_config
@@ -179,15 +376,40 @@ struct grammer {
 // the parsing was successful or not.
 template <char... charpack>
 constexpr auto parse_format() {
-    if constexpr (sizeof...(charpack) == 0) {
-        return format_result<grammer_str<charpack...>::str,
-                             format_element<0, 0>>();
-    } else {
-        return grammer<grammer_str<charpack...>::str, 0, 0, 0>::next(
-            state_out());
-    }
+    return parse_format_string<grammer_str<charpack...>::str>();
+}
+
+// the format strings of two format results one after the other
+template <typename first_t, typename second_t>
+struct concat_grammer_str {
+    constexpr static auto fixed_str = [] {
+        fixed_string<first_t::str().size() + second_t::str().size() + 1>
+            result;
+        size_t size = 0;
+        for (char c : first_t::str()) {
+            result.data()[size++] = c;
+        }
+        for (char c : second_t::str()) {
+            result.data()[size++] = c;
+        }
+        result.resize(size);
+        return result;
+    }();
+    constexpr static std::string_view str{fixed_str.view()};
+};
+
+// the format result of the format strings of two valid format results
+// one after the other.
+//
+// Each valid format string ends after a complete literal, escape or
+// parameter, so the concatenation is valid as well. It is scanned
+// again, which numbers the parameters of the second format string after
+// those of the first and merges the literals where they meet.
+template <typename first_t, typename second_t>
+constexpr auto concat_format() {
+    return parse_format_string<concat_grammer_str<first_t, second_t>::str>();
 }
 
 }  // namespace internal
 
-}  // namespace pformat
\ No newline at end of file
+}  // namespace pformat
@@ -1,19 +1,70 @@
+#pragma once
+
 #include <algorithm>
 #include <array>
 #include <cassert>
 #include <cstring>
 #include <iostream>
 #include <numeric>
+#include <string>
 #include <tuple>
 #include <type_traits>
 #include <vector>
 
+#include "capture.h"
+#include "constexpr_placement.h"
 #include "fixed_string.h"
+#include "hexdump.h"
+#include "iov.h"
+#include "memory_buffer.h"
 #include "parser.h"
 #include "placement.h"
+#include "stats.h"
+#include "structured.h"
 
 namespace pformat {
 
+// fixed capacity string returned by log_config::format_fixed
+template <size_t N>
+using fixed_string = internal::fixed_string<N>;
+
+// result of log_config::format_to_n
+struct format_to_n_result {
+    // end of the output, i.e. the position of the trailing zero
+    char *out;
+    // number of characters written excluding the trailing zero
+    size_t size;
+    // true if the output did not fit completely
+    bool truncated;
+};
+
+namespace internal {
+
+// results with a larger bound are placed into a heap scratch buffer
+constexpr size_t append_scratch_capacity = 4096;
+
+/**
+ * appends at most bound characters placed by place(char *) to str and
+ * returns the number of placed characters. place returns the end of its
+ * output.
+ *
+ * The characters are placed into a scratch buffer, on the stack up to
+ * append_scratch_capacity, and appended once. So the string grows by
+ * the placed size, not by the bound, which exceeds it for arguments
+ * without an exact size, e.g. floats.
+ */
+template <typename place_t>
+size_t append_placed(std::string &str, size_t bound, place_t &&place) {
+    basic_memory_buffer<append_scratch_capacity> scratch;
+    scratch.resize(bound);
+    char *end = place(scratch.data());
+    size_t const size = end - scratch.data();
+    str.append(scratch.data(), size);
+    return size;
+}
+
+}  // namespace internal
+
 /**
  * An instance of a instrancation of this type
  * is returned from the _fmt literal.
@@ -29,7 +80,374 @@ class log_config {
         return parse_result.get_parameter_count();
     }
 
+    // places the format elements and the arguments of the tuple
+    // into buf and returns the end of the output.
+    template <typename tuple_t>
+    static char *place(char *buf, tuple_t const &t) {
+        parse_result_t::visit(
+            [&buf](auto fe) {
+                using element_t = decltype(fe);
+                buf = placement::internal::place_literal<element_t::size()>(
+                    buf, parse_result_t::literals().data() + element_t::start);
+            },
+            [&buf, &t](auto pe) {
+                auto const &arg = std::get<pe.index>(t);
+                buf = placement::internal::place_spec<
+                    typename decltype(pe)::spec>(buf, arg);
+            });
+        return buf;
+    }
+
+    // places the format elements and the arguments of the tuple into
+    // at most n characters of buf and returns the end of the output.
+    //
+    // Stops at the first element or argument which does not fit and
+    // sets truncated, see placement::internal::place_spec_n.
+    template <typename tuple_t>
+    static char *place_n(char *buf, size_t n, tuple_t const &t,
+                         bool &truncated) {
+        char *const limit = buf + n;
+        parse_result_t::visit(
+            [&buf, limit, &truncated](auto fe) {
+                using element_t = decltype(fe);
+                if (truncated) {
+                    return;
+                }
+                if (element_t::size() > static_cast<size_t>(limit - buf)) {
+                    truncated = true;
+                    return;
+                }
+                buf = placement::internal::place_literal<element_t::size()>(
+                    buf, parse_result_t::literals().data() + element_t::start);
+            },
+            [&buf, limit, &truncated, &t](auto pe) {
+                if (truncated) {
+                    return;
+                }
+                buf = placement::internal::place_spec_n<
+                    typename decltype(pe)::spec>(buf, limit - buf,
+                                                 std::get<pe.index>(t),
+                                                 truncated);
+            });
+        return buf;
+    }
+
+    // the spec_constant of the parameter with index i
+    template <size_t i>
+    using spec_t = typename parse_result_t::template parameter_spec_t<i>;
+
+    // number of records format_batch reserves the buffer for at a time
+    static constexpr size_t batch_chunk_size = 64;
+
+    // returns the number of characters of the output for the measured
+    // arguments of the tuple, see placement::internal::measure
+    template <typename tuple_t, size_t... i>
+    static size_t measure(tuple_t const &t, std::index_sequence<i...>) {
+        return (parse_result_t::get_element_size() + ... +
+                placement::internal::measure_spec<spec_t<i>>(std::get<i>(t)));
+    }
+
+    template <typename... args_t, size_t... i>
+    static constexpr size_t static_size_bound(std::index_sequence<i...>) {
+        return (parse_result_t::get_element_size() + ... +
+                placement::internal::static_placement_size_spec<
+                    spec_t<i>, typename std::decay<args_t>::type>()) +
+               1;
+    }
+
+    // the characters format_iov references instead of placing them, i.e.
+    // strings with the default spec of at least threshold characters.
+    // Empty for all other arguments.
+    template <typename spec_t, typename arg_t>
+    static std::string_view iov_reference(arg_t const &arg,
+                                          size_t threshold) noexcept {
+        if constexpr (spec_t::value.is_default() &&
+                      (std::is_same<arg_t, std::string>::value ||
+                       std::is_same<arg_t, std::string_view>::value)) {
+            if (arg.size() >= threshold) {
+                return arg;
+            }
+        }
+        return {};
+    }
+
+    // the capacity of the fixed_string returned by format_constexpr
+    // without an explicit capacity
+    template <typename... args_t, size_t... i>
+    static constexpr size_t constexpr_size_bound(std::index_sequence<i...>) {
+        return (parse_result_t::get_element_size() + ... +
+                placement::internal::constexpr_static_size<spec_t<i>,
+                                                           args_t>()) +
+               1;
+    }
+
+    // renders the payload of a record captured with capture_to
+    template <typename... decoded_t>
+    static char *render_payload([[maybe_unused]] char const *payload,
+                                char *out) noexcept {
+        // the elements of a braced init list are evaluated in order
+        const std::tuple<decoded_t...> t{
+            binary::codec<decoded_t>::decode(payload)...};
+        return place(out, t);
+    }
+
+    static constexpr auto make_segments() noexcept {
+        std::array<binary::segment, parse_result_t::get_segment_count()>
+            segments{};
+        size_t i = 0;
+        parse_result_t::visit(
+            [&segments, &i](auto fe) {
+                segments[i++] = {false, fe.start, fe.size(), 0, {}};
+            },
+            [&segments, &i](auto pe) {
+                segments[i++] = {true, 0, 0, pe.index,
+                                 decltype(pe)::spec::value};
+            });
+        return segments;
+    }
+
+    template <typename... decoded_t>
+    static constexpr size_t make_static_size_bound() noexcept {
+        if constexpr ((placement::internal::has_static_placement_size<
+                           decoded_t>::value &&
+                       ...)) {
+            return static_string_size_bound<decoded_t...>();
+        } else {
+            return 0;
+        }
+    }
+
+    // the format site of the format string with the given decoded
+    // argument types, see binary::site
+    template <typename... decoded_t>
+    struct site_data {
+        static constexpr auto segments = make_segments();
+        // one extra element to avoid empty arrays
+        static constexpr binary::arg_type arg_types[sizeof...(decoded_t) + 1] =
+            {binary::arg_type_of<decoded_t>()..., binary::arg_type::STRING};
+        static constexpr binary::site site{
+            binary::site_id(parse_result_t::str(), arg_types,
+                            sizeof...(decoded_t)),
+            parse_result_t::str(),
+            parse_result_t::literals(),
+            segments.data(),
+            segments.size(),
+            arg_types,
+            sizeof...(decoded_t),
+            make_static_size_bound<decoded_t...>(),
+            &render_payload<decoded_t...>};
+        static inline const binary::site_registration registration{site};
+        static inline const stats::site_stats statistics{site};
+    };
+
+    template <typename... args_t>
+    using site_data_t = site_data<
+        binary::decoded_t<placement::internal::measured_t<args_t>>...>;
+
+    // returns the site of the argument types.
+    // Using a site registers it during static initialization, so only the
+    // capture paths use it. Plain formatting creates no site metadata.
+    template <typename... args_t>
+    static binary::site const &register_site() noexcept {
+        (void)&site_data_t<args_t...>::registration;
+        return site_data_t<args_t...>::site;
+    }
+
+    // the size of the binary record of the measured arguments
+    template <typename tuple_t>
+    static size_t record_size(tuple_t const &t) noexcept {
+        return std::apply(
+            [](auto const &... measured_args) {
+                return (sizeof(binary::record_header) + ... +
+                        binary::codec_t<decltype(measured_args)>::encoded_size(
+                            measured_args));
+            },
+            t);
+    }
+
+    // captures the measured arguments into a binary record stored in buf,
+    // see capture_to
+    template <typename... args_t, typename tuple_t>
+    static char *capture_measured(char *buf, tuple_t const &t) {
+        char *p = buf + sizeof(binary::record_header);
+        const size_t render_size_bound =
+            measure(t, std::index_sequence_for<args_t...>());
+        std::apply(
+            [&p](auto const &... measured_args) {
+                ((p = binary::codec_t<decltype(measured_args)>::encode(
+                      p, measured_args)),
+                 ...);
+            },
+            t);
+        const binary::record_header header{
+            static_cast<uint32_t>(p - buf),
+            static_cast<uint32_t>(render_size_bound),
+            &register_site<args_t...>()};
+        std::memcpy(buf, &header, sizeof(header));
+        return p;
+    }
+
+    // counts a call of the site of the argument types, see stats.h
+    template <typename... args_t>
+    static stats::call_scope count_call() {
+#ifdef PFORMAT_ENABLE_STATS
+        return stats::call_scope(site_data_t<args_t...>::statistics);
+#else
+        return stats::call_scope();
+#endif
+    }
+
+    // the characters of structured output in style s which do not
+    // depend on the arguments: the frame, the escaped literals and the
+    // keys of the named parameters
+    template <structured::style s>
+    static constexpr size_t structured_skeleton_size() noexcept {
+        using frame_t = structured::internal::frame<s>;
+        size_t size = frame_t::open.size() + frame_t::close_msg.size() +
+                      frame_t::close.size();
+        parse_result_t::visit(
+            [&size](auto fe) {
+                using element_t = decltype(fe);
+                size += structured::internal::escaped_literal<
+                    parse_result_t, element_t::start,
+                    element_t::size()>::escaped_size;
+            },
+            [&size](auto pe) {
+                using parameter_t = decltype(pe);
+                if constexpr (parameter_t::is_named()) {
+                    size += structured::internal::field_key<
+                        s, parse_result_t, parameter_t>::size;
+                }
+            });
+        return size;
+    }
+
+    // upper bound of the structured output in style s for the measured
+    // arguments of the tuple
+    template <structured::style s, typename tuple_t>
+    static size_t measure_structured(tuple_t const &t) {
+        size_t size = structured_skeleton_size<s>();
+        parse_result_t::visit([](auto) {}, [&size, &t](auto pe) {
+            using parameter_t = decltype(pe);
+            using spec_t = typename parameter_t::spec;
+            auto const &arg = std::get<pe.index>(t);
+            using arg_t = typename std::decay<decltype(arg)>::type;
+            size_t const measured =
+                placement::internal::measure_spec<spec_t>(arg);
+            size += structured::internal::escaped_size_bound<spec_t, arg_t>(
+                measured);
+            if constexpr (parameter_t::is_named()) {
+                size += structured::internal::field_size_bound<s, spec_t,
+                                                               arg_t>(
+                    measured);
+            }
+        });
+        return size;
+    }
+
+    // places the structured output in style s of the arguments of the
+    // tuple into buf and returns the end of the output
+    template <structured::style s, typename tuple_t>
+    static char *place_structured(char *buf, tuple_t const &t) {
+        using frame_t = structured::internal::frame<s>;
+        buf = placement::internal::place_literal<frame_t::open.size()>(
+            buf, frame_t::open.data());
+        parse_result_t::visit(
+            [&buf](auto fe) {
+                using element_t = decltype(fe);
+                using literal_t = structured::internal::escaped_literal<
+                    parse_result_t, element_t::start, element_t::size()>;
+                buf = placement::internal::place_literal<
+                    literal_t::escaped_size>(buf, literal_t::value.data);
+            },
+            [&buf, &t](auto pe) {
+                buf = structured::internal::place_escaped<
+                    typename decltype(pe)::spec>(buf, std::get<pe.index>(t));
+            });
+        buf = placement::internal::place_literal<frame_t::close_msg.size()>(
+            buf, frame_t::close_msg.data());
+        parse_result_t::visit([](auto) {}, [&buf, &t](auto pe) {
+            using parameter_t = decltype(pe);
+            if constexpr (parameter_t::is_named()) {
+                using key_t = structured::internal::field_key<
+                    s, parse_result_t, parameter_t>;
+                buf = placement::internal::place_literal<key_t::size>(
+                    buf, key_t::value.data);
+                buf = structured::internal::place_field<
+                    s, typename parameter_t::spec>(buf,
+                                                   std::get<pe.index>(t));
+            }
+        });
+        return placement::internal::place_literal<frame_t::close.size()>(
+            buf, frame_t::close.data());
+    }
+
+    template <structured::style s, typename... args_t>
+    std::string format_structured(args_t &&... args) const {
+        constexpr bool parameter_count_match =
+            parse_result_t::get_parameter_count() == sizeof...(args);
+        constexpr auto placeable = placement::test_placements<args_t...>();
+        static_assert(
+            parameter_count_match,
+            "Number of format arguments does not match format string");
+        if constexpr (!parameter_count_match || !placeable) {
+            return {};
+        } else {
+            auto call = count_call<args_t...>();
+            const std::tuple<placement::internal::measured_t<args_t>...> t{
+                args...};
+            const size_t s_bound = measure_structured<s>(t);
+            if (s_bound <= inline_format_capacity) {
+                char buf[inline_format_capacity];
+                char *end = place_structured<s>(buf, t);
+                call.finish(end - buf, s_bound);
+                return std::string(buf, end - buf);
+            }
+            auto const place_into = [&t](char *out) {
+                return place_structured<s>(out, t);
+            };
+            std::string str_result;
+            call.finish(
+                internal::append_placed(str_result, s_bound, place_into),
+                s_bound);
+            return str_result;
+        }
+    }
+
+    template <structured::style s, typename buffer_t, typename... args_t>
+    void append_structured(buffer_t &buffer, args_t &&... args) const {
+        constexpr bool parameter_count_match =
+            parse_result_t::get_parameter_count() == sizeof...(args);
+        constexpr auto placeable = placement::test_placements<args_t...>();
+        static_assert(
+            parameter_count_match,
+            "Number of format arguments does not match format string");
+        if constexpr (parameter_count_match && placeable) {
+            auto call = count_call<args_t...>();
+            const std::tuple<placement::internal::measured_t<args_t>...> t{
+                args...};
+            const size_t bound = measure_structured<s>(t);
+            if constexpr (std::is_same<buffer_t, std::string>::value) {
+                auto const place_into = [&t](char *out) {
+                    return place_structured<s>(out, t);
+                };
+                call.finish(internal::append_placed(buffer, bound, place_into),
+                            bound);
+            } else {
+                const size_t size = buffer.size();
+                buffer.reserve(size + bound);
+                char *end = place_structured<s>(buffer.data() + size, t);
+                call.finish(end - buffer.data() - size, bound);
+                buffer.resize(end - buffer.data());
+            }
+        }
+    }
+
    public:
+    // results up to this size are formatted on the stack by format(),
+    // see also memory_buffer
+    static constexpr size_t inline_format_capacity = 500;
+
     explicit constexpr log_config(parse_result_t const &result_)
         : parse_result(result_) {}
     /**
@@ -50,14 +468,40 @@ class log_config {
             size_t size{};
             parse_result.visit([&size](auto fe) { size += fe.size(); },
                                [&t, &size](auto pe) {
-                                   using placement::placement_size;
-                                   size +=
-                                       placement_size(std::get<pe.index>(t));
+                                   size += placement::internal::
+                                       placement_size_spec<
+                                           typename decltype(pe)::spec>(
+                                           std::get<pe.index>(t));
                                });
             return size + 1;
         }
     }
 
+    /**
+     * returns the upper bound on the string size generated by
+     * a format call with arguments of the given types
+     * including the trailing zero.
+     *
+     * Only available if all argument types have a static_placement_size,
+     * i.e. integers, bools, chars, enums and floating point numbers.
+     */
+    template <typename... args_t>
+    static constexpr size_t static_string_size_bound() noexcept {
+        static_assert(
+            (placement::internal::has_static_placement_size<
+                 typename std::decay<args_t>::type>::value &&
+             ...),
+            "Argument types have no static size bound");
+        if constexpr (!(placement::internal::has_static_placement_size<
+                            typename std::decay<args_t>::type>::value &&
+                        ...)) {
+            return 0;
+        } else {
+            return static_size_bound<args_t...>(
+                std::index_sequence_for<args_t...>());
+        }
+    }
+
     template <typename... args_t>
     std::string operator()(args_t &&... args) const {
         return format(std::forward<args_t>(args)...);
@@ -66,6 +510,12 @@ class log_config {
     /**
      * Use the format definiton and the arguments to
      * create a formatted string.
+     *
+     * Each argument is measured exactly once. Results up to
+     * inline_format_capacity characters are formatted on the stack and
+     * copied into a string of the exact size (staying within the small
+     * string optimization where possible), larger results are placed into
+     * a scratch buffer first, see internal::append_placed.
      */
     template <typename... args_t>
     std::string format(args_t &&... args) const {
@@ -81,25 +531,20 @@ class log_config {
             // processing
             return {};
         } else {
-            const auto s = string_size_bound(std::forward<args_t>(args)...);
-            std::string str_result;
-            str_result.resize(s);  // reserve sufficient space for the output
-            auto t = std::forward_as_tuple(std::forward<args_t>(args)...);
-            char *buf = str_result.data();
+            auto call = count_call<args_t...>();
+            const std::tuple<placement::internal::measured_t<args_t>...> t{
+                args...};
+            const size_t s = measure(t, std::index_sequence_for<args_t...>());
 
-            parse_result_t::visit(
-                [this, &buf](auto fe) {
-                    using placement::unsafe_place;
-                    buf = unsafe_place(
-                        buf, parse_result.str().data() + fe.start, fe.size());
-                },
-                [this, &t, &buf](auto pe) {
-                    using placement::unsafe_place;
-                    auto const &arg = std::get<pe.index>(t);
-                    buf = unsafe_place(buf, arg);
-                });
-            *buf = 0;
-            str_result.resize(buf - str_result.data());
+            if (s <= inline_format_capacity) {
+                char buf[inline_format_capacity];
+                char *end = place(buf, t);
+                call.finish(end - buf, s);
+                return std::string(buf, end - buf);
+            }
+            auto const place_into = [&t](char *out) { return place(out, t); };
+            std::string str_result;
+            call.finish(internal::append_placed(str_result, s, place_into), s);
             return str_result;
         }
     }
@@ -129,33 +574,573 @@ class log_config {
                 // we will already have static asserted when getting here.
                 return {};
             } else {
-                auto t = std::forward_as_tuple(std::forward<args_t>(args)...);
-
-                parse_result_t::visit(
-                    [this, &buf](auto fe) {
-                        using placement::unsafe_place;
-                        buf = unsafe_place(buf,
-                                           parse_result.str().data() + fe.start,
-                                           fe.size());
-                    },
-                    [&buf, &t](auto pe) {
-                        using placement::unsafe_place;
-                        auto const &arg = std::get<pe.index>(t);
-                        buf = unsafe_place(buf, arg);
-                    });
-                *buf = 0;
-                return buf;
+                auto call = count_call<args_t...>();
+                char *end = place(buf, std::forward_as_tuple(
+                                           std::forward<args_t>(args)...));
+                call.finish(end - buf);
+                *end = 0;
+                return end;
             }
         }
     }
 
+    /**
+     * Use the format definiton and the arguments to create a formatted
+     * output and store it in the buffer of size n, e.g. a fixed size
+     * log slot.
+     *
+     * Never writes more than n characters including the trailing zero.
+     * If the output does not fit, it ends before the first format
+     * element or argument which does not fit. Strings are cut at a UTF-8
+     * character boundary instead. Nothing is written if n is 0.
+     *
+     * If the static_string_size_bound of the argument types is at
+     * most n, the output is placed without any bounds checks.
+     */
+    template <typename... args_t>
+    format_to_n_result format_to_n(char *buf, size_t n,
+                                   args_t &&... args) const {
+        constexpr bool parameter_count_match =
+            parse_result_t::get_parameter_count() == sizeof...(args);
+        constexpr auto placeable = placement::test_placements<args_t...>();
+        static_assert(
+            parameter_count_match,
+            "Number of format arguments does not match format string");
+        if constexpr (!parameter_count_match || !placeable) {
+            return {buf, 0, false};
+        } else {
+            if (n == 0) {
+                return {buf, 0, true};
+            }
+            char *end;
+            if constexpr ((placement::internal::has_static_placement_size<
+                               typename std::decay<args_t>::type>::value &&
+                           ...)) {
+                if (static_size_bound<args_t...>(
+                        std::index_sequence_for<args_t...>()) <= n) {
+                    end = place(buf, std::forward_as_tuple(
+                                         std::forward<args_t>(args)...));
+                    *end = 0;
+                    return {end, static_cast<size_t>(end - buf), false};
+                }
+            }
+            const std::tuple<placement::internal::measured_t<args_t>...> t{
+                args...};
+            bool truncated = false;
+            if (measure(t, std::index_sequence_for<args_t...>()) < n) {
+                end = place(buf, t);
+            } else {
+                end = place_n(buf, n - 1, t, truncated);
+            }
+            *end = 0;
+            return {end, static_cast<size_t>(end - buf), truncated};
+        }
+    }
+
+    /**
+     * Use the format definiton and the arguments to create a formatted
+     * output and append it to the buffer.
+     *
+     * Each argument is measured exactly once and the buffer grows at
+     * most once per call. Appending to a memory_buffer does not allocate
+     * as long as the output fits into its capacity.
+     */
+    template <size_t inline_capacity, typename... args_t>
+    void format_append(basic_memory_buffer<inline_capacity> &buffer,
+                       args_t &&... args) const {
+        constexpr bool parameter_count_match =
+            parse_result_t::get_parameter_count() == sizeof...(args);
+        constexpr auto placeable = placement::test_placements<args_t...>();
+        static_assert(
+            parameter_count_match,
+            "Number of format arguments does not match format string");
+        if constexpr (parameter_count_match && placeable) {
+            auto call = count_call<args_t...>();
+            const std::tuple<placement::internal::measured_t<args_t>...> t{
+                args...};
+            const size_t size = buffer.size();
+            const size_t measured =
+                measure(t, std::index_sequence_for<args_t...>());
+            buffer.reserve(size + measured);
+            char *end = place(buffer.data() + size, t);
+            call.finish(end - buffer.data() - size, measured);
+            buffer.resize(end - buffer.data());
+        }
+    }
+
+    /**
+     * Use the format definiton and the arguments to create a formatted
+     * output and append it to the string.
+     *
+     * Each argument is measured exactly once and the string grows at
+     * most once per call.
+     */
+    template <typename... args_t>
+    void format_append(std::string &str, args_t &&... args) const {
+        constexpr bool parameter_count_match =
+            parse_result_t::get_parameter_count() == sizeof...(args);
+        constexpr auto placeable = placement::test_placements<args_t...>();
+        static_assert(
+            parameter_count_match,
+            "Number of format arguments does not match format string");
+        if constexpr (parameter_count_match && placeable) {
+            auto call = count_call<args_t...>();
+            const std::tuple<placement::internal::measured_t<args_t>...> t{
+                args...};
+            const size_t measured =
+                measure(t, std::index_sequence_for<args_t...>());
+            auto const place_into = [&t](char *out) { return place(out, t); };
+            call.finish(internal::append_placed(str, measured, place_into),
+                        measured);
+        }
+    }
+
+    /**
+     * Use the format definiton and the arguments to create a JSON
+     * object, see structured.h.
+     *
+     * The formatted message becomes the "msg" member and every named
+     * parameter a member of the same name. Numbers and bools with the
+     * default spec are JSON numbers and bools, all other values strings.
+     */
+    template <typename... args_t>
+    std::string format_json(args_t &&... args) const {
+        return format_structured<structured::style::json>(
+            std::forward<args_t>(args)...);
+    }
+
+    /**
+     * Use the format definiton and the arguments to create a logfmt
+     * line, see structured.h.
+     *
+     * Like format_json, but numbers and bools are unquoted unless the
+     * spec pads them.
+     */
+    template <typename... args_t>
+    std::string format_logfmt(args_t &&... args) const {
+        return format_structured<structured::style::logfmt>(
+            std::forward<args_t>(args)...);
+    }
+
+    // appends the output of format_json to the buffer
+    template <size_t inline_capacity, typename... args_t>
+    void format_json_append(basic_memory_buffer<inline_capacity> &buffer,
+                            args_t &&... args) const {
+        append_structured<structured::style::json>(
+            buffer, std::forward<args_t>(args)...);
+    }
+
+    template <typename... args_t>
+    void format_json_append(std::string &str, args_t &&... args) const {
+        append_structured<structured::style::json>(
+            str, std::forward<args_t>(args)...);
+    }
+
+    // appends the output of format_logfmt to the buffer
+    template <size_t inline_capacity, typename... args_t>
+    void format_logfmt_append(basic_memory_buffer<inline_capacity> &buffer,
+                              args_t &&... args) const {
+        append_structured<structured::style::logfmt>(
+            buffer, std::forward<args_t>(args)...);
+    }
+
+    template <typename... args_t>
+    void format_logfmt_append(std::string &str, args_t &&... args) const {
+        append_structured<structured::style::logfmt>(
+            str, std::forward<args_t>(args)...);
+    }
+
+    /**
+     * Use the format definiton and the arguments to create a formatted
+     * output and append it as segments to the iov_builder, e.g. to write
+     * it with a single writev (see iov_builder::write_to).
+     *
+     * Literals and string arguments with the default spec of at least
+     * out.reference_threshold() characters are referenced instead of
+     * copied, so the arguments have to outlive the segments. Everything
+     * else is placed into the scratch memory of the builder.
+     */
+    template <typename... args_t>
+    void format_iov(iov_builder &out, args_t &&... args) const {
+        constexpr bool parameter_count_match =
+            parse_result_t::get_parameter_count() == sizeof...(args);
+        constexpr auto placeable = placement::test_placements<args_t...>();
+        static_assert(
+            parameter_count_match,
+            "Number of format arguments does not match format string");
+        if constexpr (parameter_count_match && placeable) {
+            const std::tuple<placement::internal::measured_t<args_t>...> t{
+                args...};
+            size_t const threshold = out.reference_threshold();
+            char const *const literals = parse_result_t::literals().data();
+
+            size_t scratch_size = 0;
+            parse_result_t::visit(
+                [&scratch_size, threshold](auto fe) {
+                    using element_t = decltype(fe);
+                    if (element_t::size() < threshold) {
+                        scratch_size += element_t::size();
+                    }
+                },
+                [&scratch_size, threshold, &t](auto pe) {
+                    using spec_t = typename decltype(pe)::spec;
+                    auto const &arg = std::get<pe.index>(t);
+                    if (iov_reference<spec_t>(arg, threshold).empty()) {
+                        scratch_size +=
+                            placement::internal::measure_spec<spec_t>(arg);
+                    }
+                });
+
+            // [run, buf) is placed but not yet committed
+            char *buf = out.scratch(scratch_size);
+            char *run = buf;
+            auto add_reference = [&out, &buf, &run](std::string_view s) {
+                out.commit(run, buf);
+                out.reference(s.data(), s.size());
+                run = buf;
+            };
+            parse_result_t::visit(
+                [&buf, threshold, literals, &add_reference](auto fe) {
+                    using element_t = decltype(fe);
+                    char const *literal = literals + element_t::start;
+                    if (element_t::size() >= threshold) {
+                        add_reference({literal, element_t::size()});
+                    } else {
+                        buf = placement::internal::place_literal<
+                            element_t::size()>(buf, literal);
+                    }
+                },
+                [&buf, threshold, &t, &add_reference](auto pe) {
+                    using spec_t = typename decltype(pe)::spec;
+                    auto const &arg = std::get<pe.index>(t);
+                    auto const reference =
+                        iov_reference<spec_t>(arg, threshold);
+                    if (!reference.empty()) {
+                        add_reference(reference);
+                    } else {
+                        buf = placement::internal::place_spec<spec_t>(buf,
+                                                                      arg);
+                    }
+                });
+            out.commit(run, buf);
+        }
+    }
+
+    /**
+     * Formats count records with the same format and appends them to
+     * the buffer, separated by the separator.
+     *
+     * Each record holds the arguments of one format call. The output is
+     * identical to format_append of each record, but the buffer grows at
+     * most once per batch_chunk_size records and records of types with a
+     * static placement size are not measured one by one.
+     */
+    template <size_t inline_capacity, typename... record_args_t>
+    void format_batch(std::tuple<record_args_t...> const *records,
+                      size_t count,
+                      basic_memory_buffer<inline_capacity> &buffer,
+                      std::string_view separator = "\n") const {
+        using record_t = std::tuple<record_args_t...>;
+        constexpr bool parameter_count_match =
+            parse_result_t::get_parameter_count() ==
+            sizeof...(record_args_t);
+        constexpr auto placeable =
+            placement::test_placements<record_args_t...>();
+        static_assert(
+            parameter_count_match,
+            "Number of format arguments does not match format string");
+        if constexpr (parameter_count_match && placeable) {
+            using indices_t = std::index_sequence_for<record_args_t...>;
+            for (size_t begin = 0; begin < count; begin += batch_chunk_size) {
+                size_t const n = std::min(batch_chunk_size, count - begin);
+                record_t const *chunk = records + begin;
+                size_t size = n * separator.size();
+                if constexpr ((placement::internal::has_static_placement_size<
+                                   record_args_t>::value &&
+                               ...)) {
+                    size += n * static_size_bound<record_args_t...>(
+                                    indices_t());
+                } else {
+                    for (size_t r = 0; r < n; ++r) {
+                        size += measure(chunk[r], indices_t());
+                    }
+                }
+                buffer.reserve(buffer.size() + size);
+
+                char *p = buffer.data() + buffer.size();
+                for (size_t r = 0; r < n; ++r) {
+                    if (begin + r > 0) {
+                        std::memcpy(p, separator.data(), separator.size());
+                        p += separator.size();
+                    }
+                    p = place(p, chunk[r]);
+                }
+                buffer.resize(p - buffer.data());
+            }
+        }
+    }
+
+    /**
+     * Formats the records with the same format and appends them to the
+     * buffer, separated by the separator.
+     *
+     * See format_batch.
+     */
+    template <size_t inline_capacity, typename... record_args_t>
+    void format_batch(std::vector<std::tuple<record_args_t...>> const &records,
+                      basic_memory_buffer<inline_capacity> &buffer,
+                      std::string_view separator = "\n") const {
+        format_batch(records.data(), records.size(), buffer, separator);
+    }
+
+    /**
+     * Use the format definiton and the arguments to create a
+     * formatted fixed_string, which stores the output inline without
+     * any heap allocation.
+     *
+     * Only available if all arguments have a static size bound,
+     * see static_string_size_bound.
+     */
+    template <typename... args_t>
+    auto format_fixed(args_t &&... args) const {
+        constexpr bool parameter_count_match =
+            parse_result_t::get_parameter_count() == sizeof...(args);
+        static_assert(
+            parameter_count_match,
+            "Number of format arguments does not match format string");
+        if constexpr (!parameter_count_match) {
+            // we will already have static asserted when getting here
+            return internal::fixed_string<1>();
+        } else {
+            internal::fixed_string<static_string_size_bound<args_t...>()>
+                result{internal::uninitialized};
+            char *end =
+                place(result.data(),
+                      std::forward_as_tuple(std::forward<args_t>(args)...));
+            result.resize(end - result.data());
+            return result;
+        }
+    }
+
+    /**
+     * Use the format definiton and the arguments to create a formatted
+     * fixed_string in a constant expression, e.g.
+     *
+     *     constexpr auto banner =
+     *         "{} {}.{}"_fmt.format_constexpr("pformat", 1, 2);
+     *
+     * Supports integers, bools, chars, enums, string literals, C strings
+     * and string_views with all format specs.
+     *
+     * The capacity including the trailing zero defaults to the static
+     * size bound of the argument types, with string literals counting
+     * with their length. It has to be given for C strings and
+     * string_views. Exceeding it is a compile error in a constant
+     * expression and truncates the output otherwise.
+     */
+    template <size_t capacity = 0, typename... args_t>
+    constexpr auto format_constexpr(args_t const &... args) const {
+        constexpr bool parameter_count_match =
+            parse_result_t::get_parameter_count() == sizeof...(args);
+        constexpr bool placeable =
+            (placement::internal::is_constexpr_placeable<args_t>() && ...);
+        constexpr bool bounded =
+            capacity > 0 ||
+            (placement::internal::has_constexpr_static_size<args_t>() &&
+             ...);
+        static_assert(
+            parameter_count_match,
+            "Number of format arguments does not match format string");
+        static_assert(placeable,
+                      "format_constexpr only supports integers, bools, "
+                      "chars, enums and strings");
+        static_assert(bounded,
+                      "Argument types have no static size bound, pass the "
+                      "capacity");
+        if constexpr (!parameter_count_match || !placeable || !bounded) {
+            // we will already have static asserted when getting here
+            return internal::fixed_string<1>();
+        } else {
+            constexpr size_t size = []() {
+                if constexpr (capacity > 0) {
+                    return capacity;
+                } else {
+                    return constexpr_size_bound<args_t...>(
+                        std::index_sequence_for<args_t...>());
+                }
+            }();
+            internal::fixed_string<size> result;
+            placement::internal::constexpr_writer out{result.data(),
+                                                      size - 1};
+            auto const t = std::forward_as_tuple(args...);
+            parse_result_t::visit(
+                [&out](auto fe) {
+                    using element_t = decltype(fe);
+                    out.put(parse_result_t::literals().substr(
+                        element_t::start, element_t::size()));
+                },
+                [&out, &t](auto pe) {
+                    placement::internal::constexpr_place_spec<
+                        typename decltype(pe)::spec>(out,
+                                                     std::get<pe.index>(t));
+                });
+            if (out.size >= size) {
+                placement::internal::format_constexpr_capacity_exceeded();
+                out.size = size - 1;
+            }
+            result.resize(out.size);
+            return result;
+        }
+    }
+
+    /**
+     * returns an upper bound on the size of the binary record
+     * created by capture_to with the given arguments.
+     */
+    template <typename... args_t>
+    size_t capture_size(args_t &&... args) const {
+        constexpr bool parameter_count_match =
+            parse_result_t::get_parameter_count() == sizeof...(args);
+        constexpr auto placeable = placement::test_placements<args_t...>();
+        static_assert(
+            parameter_count_match,
+            "Number of format arguments does not match format string");
+        if constexpr (!parameter_count_match || !placeable) {
+            return 0;
+        } else {
+            const std::tuple<placement::internal::measured_t<args_t>...> t{
+                args...};
+            return record_size(t);
+        }
+    }
+
+    /**
+     * Captures the arguments into a binary record stored in buf
+     * and returns the end of the record.
+     *
+     * The buffer is expected to have at least a size of
+     * capture_size(...) many bytes. Only the raw bytes of the arguments
+     * are copied. pformat::render turns the record into the same text
+     * format(...) would have produced.
+     */
+    template <typename... args_t>
+    char *capture_to(char *buf, args_t &&... args) const {
+        constexpr bool parameter_count_match =
+            parse_result_t::get_parameter_count() == sizeof...(args);
+        constexpr auto placeable = placement::test_placements<args_t...>();
+        static_assert(
+            parameter_count_match,
+            "Number of format arguments does not match format string");
+        if constexpr (!parameter_count_match || !placeable) {
+            return buf;
+        } else {
+            const std::tuple<placement::internal::measured_t<args_t>...> t{
+                args...};
+            return capture_measured<args_t...>(buf, t);
+        }
+    }
+
+    /**
+     * Captures the arguments into a binary record stored in the buffer
+     * returned by alloc(size), where size is capture_size(...).
+     *
+     * The arguments are measured only once. returns the end of the
+     * record, or nullptr if alloc returned nullptr, e.g. because a queue
+     * is full.
+     */
+    template <typename alloc_t, typename... args_t>
+    char *capture_with(alloc_t &&alloc, args_t &&... args) const {
+        constexpr bool parameter_count_match =
+            parse_result_t::get_parameter_count() == sizeof...(args);
+        constexpr auto placeable = placement::test_placements<args_t...>();
+        static_assert(
+            parameter_count_match,
+            "Number of format arguments does not match format string");
+        if constexpr (!parameter_count_match || !placeable) {
+            return nullptr;
+        } else {
+            const std::tuple<placement::internal::measured_t<args_t>...> t{
+                args...};
+            char *buf = alloc(record_size(t));
+            if (buf == nullptr) {
+                return nullptr;
+            }
+            return capture_measured<args_t...>(buf, t);
+        }
+    }
+
+    /**
+     * Captures the arguments into a binary record.
+     *
+     * See capture_to.
+     */
+    template <typename... args_t>
+    std::vector<char> capture(args_t &&... args) const {
+        std::vector<char> record(capture_size(args...));
+        char *end = capture_to(record.data(), std::forward<args_t>(args)...);
+        record.resize(end - record.data());
+        return record;
+    }
+
+    /**
+     * returns the format site of this format string and the given
+     * argument types.
+     *
+     * All sites used by capture calls or get_site are registered in the
+     * process-wide registry (see binary::for_each_site) before main
+     * starts.
+     */
+    template <typename... args_t>
+    static binary::site const &get_site() noexcept {
+        return register_site<args_t...>();
+    }
+
+    // returns the stable id of the site of the argument types
+    template <typename... args_t>
+    static constexpr uint64_t get_site_id() noexcept {
+        return site_data_t<args_t...>::site.id;
+    }
+
     // return true if a format string is valid.
     // true for all log config objects returned by _fmt.
     constexpr bool ok() const noexcept {
         return parse_result.is_valid_format_string();
     }
+
+    /**
+     * returns the log config of this format string followed by the
+     * format string of other, e.g. a log prefix and a message:
+     *
+     *     constexpr auto line = "[{}] {}:{} "_fmt + "page {} flushed"_fmt;
+     *     line.format(level, file, line_no, page_id);
+     *
+     * The concatenation is parsed at compile time. The parameters of
+     * other follow those of this format string, and the literals where
+     * both meet become a single literal. A call formats both parts with
+     * a single size bound and a single pass over the output.
+     */
+    template <typename other_t>
+    constexpr auto operator+(log_config<other_t> const &other) const noexcept {
+        static_assert(parse_result_t::is_valid_format_string() &&
+                          other_t::is_valid_format_string(),
+                      "Only valid format strings can be concatenated");
+        (void)other;
+        return log_config<decltype(
+            internal::concat_format<parse_result_t, other_t>())>(
+            internal::concat_format<parse_result_t, other_t>());
+    }
 };  // namespace pformat
 
+/**
+ * returns the log config of the format strings one after the other,
+ * see log_config::operator+.
+ */
+template <typename first_t, typename... rest_t>
+constexpr auto concat(log_config<first_t> const &first,
+                      log_config<rest_t> const &... rest) noexcept {
+    return (first + ... + rest);
+}
+
 #ifdef __clang__
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wgnu-string-literal-operator-template"
@@ -177,14 +1162,27 @@ constexpr auto operator""_unchecked_fmt() noexcept {
 static_assert(""_unchecked_fmt.ok());
 static_assert("foo"_unchecked_fmt.ok());
 static_assert("foo {}"_unchecked_fmt.ok());
-static_assert(!"foo {a}"_unchecked_fmt.ok());
+static_assert("foo {a}"_unchecked_fmt.ok());
+static_assert("foo {a_1:>4} {}"_unchecked_fmt.ok());
+static_assert(!"foo {1}"_unchecked_fmt.ok());
+static_assert(!"foo {a-b}"_unchecked_fmt.ok());
 static_assert("foo {} bar {}"_unchecked_fmt.ok());
+static_assert("foo {:x} {:08X} {:>10} {:*^6} {:.3f} {:}"_unchecked_fmt.ok());
+static_assert(!"foo {:a}"_unchecked_fmt.ok());
+static_assert(!"foo {:.x}"_unchecked_fmt.ok());
+static_assert(!"foo {:.3x}"_unchecked_fmt.ok());
+static_assert("foo {:.19f}"_unchecked_fmt.ok());
+static_assert(!"foo {:.20f}"_unchecked_fmt.ok());
+static_assert(!"foo {:08x"_unchecked_fmt.ok());
+static_assert(!"foo {:{{}}"_unchecked_fmt.ok());
 static_assert("foo {{"_unchecked_fmt.ok());
 static_assert("foo }}"_unchecked_fmt.ok());
 static_assert("foo {{}}"_unchecked_fmt.ok());
 static_assert("foo }}"_unchecked_fmt.ok());
 static_assert(!"foo {"_unchecked_fmt.ok());
 static_assert(!"foo {{}"_unchecked_fmt.ok());
+static_assert(("foo {{"_unchecked_fmt + "{}}}"_unchecked_fmt).ok());
+static_assert(("{}"_unchecked_fmt + ""_unchecked_fmt).ok());
 
 }  // namespace internal
 
@@ -1,19 +1,57 @@
+#pragma once
+
 #include <algorithm>
 #include <array>
 #include <cassert>
+#include <cstdint>
 #include <cstring>
 #include <iostream>
+#include <iterator>
+#include <limits>
 #include <numeric>
+#include <string>
+#include <string_view>
 #include <tuple>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
+#include "floating_point.h"
+#include "integer.h"
+#include "spec.h"
+
 namespace pformat {
 
+/**
+ * customization point to place user-defined types, resolved at compile
+ * time, so the placement can be inlined.
+ *
+ * A specialization provides
+ *
+ *   // places the value and returns the end of the output
+ *   static char *place(char *buf, type_t const &value) noexcept;
+ *
+ * and at least one of
+ *
+ *   // upper bound of the characters of every value
+ *   static constexpr size_t max_size = ...;
+ *
+ *   // upper bound of the characters of the value
+ *   static size_t size(type_t const &value) noexcept;
+ *
+ * With max_size the type has a static_placement_size, so it works with
+ * format_fixed and static_string_size_bound. size is preferred to
+ * measure a value if both are provided.
+ */
+template <typename type_t, typename = void>
+struct formatter {};
+
 namespace placement {
 
 // base types for diag extensions
-// for user defined types
+// for user defined types.
+//
+// Both functions are virtual, prefer pformat::formatter.
 struct format_extention {
     // return an upper bound on the number of characters unsafe_place
     // might produce
@@ -27,46 +65,22 @@ struct format_extention {
     virtual char *unsafe_place(char *buf) const = 0;
 };
 
-// basic reverse based itoa.
-// can be optimized later
 template <typename int_t,
           typename std::enable_if<std::is_integral<int_t>::value &&
                                       std::is_signed<int_t>::value,
                                   int>::type * = nullptr>
 char *unsafe_place(char *buf, int_t value) noexcept {
-    using unsigned_int_t = typename std::make_unsigned<int_t>::type;
-    bool neg = value < int_t();
-    unsigned_int_t i = unsigned_int_t() +
-                       (-(neg * 2 - 1) * static_cast<unsigned_int_t>(value));
-    char *p = buf;
-
-    do {
-        unsigned_int_t lsd = i % 10U;
-        i /= 10;
-        *p++ = 0x30 + lsd;  // 0x30 is 0 in ASCSII
-    } while (i != 0);
-
-    if (neg) {
-        *p++ = '-';
-    }
-    *p = '\0';
-    std::reverse(buf, p);
-    return p;
-}
-
-template <unsigned base_v>
-inline char integer_place_char(char i) noexcept {
-    static_assert(base_v == 10 || base_v == 16,
-                  "Only 10 and 16 are supported as bases");
-    constexpr char base = '0';
-    if constexpr (base_v == 10) {
-        return base + i;
+    static_assert(sizeof(int_t) <= sizeof(uint64_t),
+                  "Only integers to 64-bit are supported");
+    using uint_t = internal::kernel_uint_t<int_t>;
+    // the negation is done in the unsigned domain, so the minimum
+    // value does not overflow
+    uint_t abs_value = static_cast<uint_t>(value);
+    if (value < 0) {
+        abs_value = uint_t() - abs_value;
+        *buf++ = '-';
     }
-    constexpr char diff = 'a' - (base + 10);
-    bool higher =
-        i == 10 || i == 11 || i == 12 || i == 13 || i == 14 || i == 15;
-    auto offset = higher * diff;
-    return base + offset + i;
+    return internal::place_decimal(buf, abs_value);
 }
 
 template <
@@ -76,17 +90,14 @@ template <
 char *unsafe_place(char *buf, int_t value) noexcept {
     static_assert(base_v == 10 || base_v == 16,
                   "Only 10 and 16 are supported as bases");
-    int_t i = value;
-    char *p = buf;
-
-    do {
-        char lsd = i % base_v;
-        i /= base_v;
-        *p++ = integer_place_char<base_v>(lsd);
-    } while (i != 0);
-    *p = '\0';
-    std::reverse(buf, p);
-    return p;
+    static_assert(sizeof(int_t) <= sizeof(uint64_t),
+                  "Only integers to 64-bit are supported");
+    using uint_t = internal::kernel_uint_t<int_t>;
+    if constexpr (base_v == 10) {
+        return internal::place_decimal(buf, static_cast<uint_t>(value));
+    } else {
+        return internal::place_hex(buf, static_cast<uint_t>(value));
+    }
 }
 
 inline char *unsafe_place(char *buf, char value) noexcept {
@@ -101,10 +112,32 @@ char *unsafe_place(char *buf, enum_t value) noexcept {
     return unsafe_place(buf, static_cast<int_t>(value));
 }
 
+// floating point numbers are placed as printf's %f would do
 inline char *unsafe_place(char *buf, double value) noexcept {
-    // yeah, I don't really want to write this.
-    auto i = std::snprintf(buf, 20, "%f", value);
-    return buf + i;
+    return internal::place_fixed(buf, value, 6);
+}
+
+inline char *unsafe_place(char *buf, float value) noexcept {
+    return internal::place_fixed(buf, value, 6);
+}
+
+// long double is placed as double, digits beyond double precision are lost
+inline char *unsafe_place(char *buf, long double value) noexcept {
+    return unsafe_place(buf, static_cast<double>(value));
+}
+
+// wrapper to place a short representation of a floating point number
+// that reads back to the same value (Grisu2).
+//
+// See pformat::shortest.
+template <typename float_t>
+struct shortest_float {
+    float_t value;
+};
+
+template <typename float_t>
+char *unsafe_place(char *buf, shortest_float<float_t> const &v) noexcept {
+    return internal::place_shortest(buf, v.value);
 }
 
 inline char *unsafe_place(char *buf, bool value) noexcept {
@@ -137,6 +170,49 @@ inline char *unsafe_place(char *buf, char const *str_begin,
     return buf + len;
 }
 
+namespace internal {
+
+// largest power of two not above n
+constexpr size_t floor_pow2(size_t n) noexcept {
+    size_t p = 1;
+    while (p * 2 <= n) {
+        p *= 2;
+    }
+    return p;
+}
+
+/**
+ * places a literal of a compile-time size with constant-size moves.
+ *
+ * Literals up to 32 characters take one or two (overlapping) moves of
+ * 1, 2, 4, 8, 16 or 32 bytes, longer literals 32-byte moves. Nothing is
+ * written past buf + size. With a literal from the literal pool the
+ * compiler emits immediate stores.
+ */
+template <size_t size>
+inline char *place_literal(char *buf, char const *literal) noexcept {
+    constexpr size_t wide = 32;
+    if constexpr (size == 0) {
+        return buf;
+    } else if constexpr (size <= wide) {
+        constexpr size_t chunk = floor_pow2(size);
+        std::memcpy(buf, literal, chunk);
+        if constexpr (chunk != size) {
+            std::memcpy(buf + size - chunk, literal + size - chunk, chunk);
+        }
+    } else {
+        for (size_t i = 0; i + wide <= size; i += wide) {
+            std::memcpy(buf + i, literal + i, wide);
+        }
+        if constexpr (size % wide != 0) {
+            std::memcpy(buf + size - wide, literal + size - wide, wide);
+        }
+    }
+    return buf + size;
+}
+
+}  // namespace internal
+
 template <typename format_extention_t,
           typename std::enable_if<std::is_base_of<
               format_extention, format_extention_t>::value>::type * = nullptr>
@@ -147,21 +223,38 @@ inline char *unsafe_place(char *buf, format_extention_t const &d) {
 // placement_size returns the maximal size a value can take in a formatted
 // string.
 //
-// we assume the longest integral is 64-bit and use that number
+// the size of integers depends on their width, e.g. 4 for int8_t (-128)
+// and 20 for uint64_t (18446744073709551615)
 template <typename int_t, typename std::enable_if<
                               std::is_integral<int_t>::value>::type * = nullptr>
 constexpr size_t placement_size(int_t) noexcept {
-    static_assert(sizeof(int_t) < 64, "Only integers to 64-bit are supported");
-    // len(18446744073709551615) == 20
-    return 20;
+    static_assert(sizeof(int_t) <= sizeof(uint64_t),
+                  "Only integers to 64-bit are supported");
+    return internal::max_decimal_size<int_t>();
 }
 
-// size of a floating point number if placed
-template <typename float_t,
-          typename std::enable_if<std::is_floating_point<float_t>::value>::type
-              * = nullptr>
-constexpr size_t placement_size(float_t) noexcept {
-    return 20;
+// size of a bool if placed ("false")
+constexpr size_t placement_size(bool) noexcept { return 5; }
+
+// size of a floating point number if placed.
+//
+// %f prints all integral digits, e.g. 1e300 has 301 characters.
+constexpr size_t placement_size(double) noexcept {
+    return internal::fixed_placement_size<double>(6);
+}
+
+constexpr size_t placement_size(float) noexcept {
+    return internal::fixed_placement_size<float>(6);
+}
+
+constexpr size_t placement_size(long double) noexcept {
+    return placement_size(0.0);
+}
+
+// size of the round-trip representation of a floating point number
+template <typename float_t>
+constexpr size_t placement_size(shortest_float<float_t> const &) noexcept {
+    return internal::shortest_placement_size<float_t>();
 }
 
 // size of a char if placed
@@ -198,6 +291,152 @@ inline constexpr size_t placement_size(std::string_view const &s) noexcept {
 // size of a const char * if placed
 inline size_t placement_size(const char *s) noexcept { return std::strlen(s); }
 
+// exact_size returns the exact number of characters unsafe_place
+// produces for a value.
+//
+// It is only provided for types for which this is cheap to compute.
+// Other types fall back to placement_size.
+template <typename int_t,
+          typename std::enable_if<std::is_integral<int_t>::value &&
+                                      std::is_signed<int_t>::value,
+                                  int>::type * = nullptr>
+inline size_t exact_size(int_t value) noexcept {
+    using uint_t = internal::kernel_uint_t<int_t>;
+    uint_t abs_value = static_cast<uint_t>(value);
+    if (value < 0) {
+        abs_value = uint_t() - abs_value;
+    }
+    return internal::count_digits(abs_value) + (value < 0);
+}
+
+template <
+    typename int_t,
+    typename std::enable_if<std::is_integral<int_t>::value &&
+                            !std::is_signed<int_t>::value>::type * = nullptr>
+inline size_t exact_size(int_t value) noexcept {
+    using uint_t = internal::kernel_uint_t<int_t>;
+    return internal::count_digits(static_cast<uint_t>(value));
+}
+
+constexpr size_t exact_size(bool value) noexcept { return 5 - value; }
+
+constexpr size_t exact_size(char) noexcept { return 1; }
+
+template <typename enum_t, typename std::enable_if<
+                               std::is_enum<enum_t>::value>::type * = nullptr>
+inline size_t exact_size(enum_t value) noexcept {
+    using int_t = typename std::underlying_type<enum_t>::type;
+    return exact_size(static_cast<int_t>(value));
+}
+
+inline size_t exact_size(std::string const &s) noexcept { return s.size(); }
+
+constexpr size_t exact_size(std::string_view const &s) noexcept {
+    return s.size();
+}
+
+namespace internal {
+
+template <typename type_t, typename = void>
+struct has_formatter : std::false_type {};
+
+template <typename type_t>
+struct has_formatter<
+    type_t, std::void_t<decltype(formatter<type_t>::place(
+                std::declval<char *>(), std::declval<type_t const &>()))>>
+    : std::true_type {};
+
+template <typename type_t, typename = void>
+struct has_formatter_max_size : std::false_type {};
+
+template <typename type_t>
+struct has_formatter_max_size<
+    type_t, std::void_t<decltype(formatter<type_t>::max_size)>>
+    : std::true_type {};
+
+template <typename type_t, typename = void>
+struct has_formatter_size : std::false_type {};
+
+template <typename type_t>
+struct has_formatter_size<
+    type_t, std::void_t<decltype(formatter<type_t>::size(
+                std::declval<type_t const &>()))>> : std::true_type {};
+
+}  // namespace internal
+
+// result_t if type_t has a formatter with a size bound
+template <typename type_t, typename result_t>
+using if_formatter_t = typename std::enable_if<
+    internal::has_formatter<type_t>::value &&
+        (internal::has_formatter_max_size<type_t>::value ||
+         internal::has_formatter_size<type_t>::value),
+    result_t>::type;
+
+// placement of types with a pformat::formatter
+template <typename type_t>
+inline if_formatter_t<type_t, char *> unsafe_place(
+    char *buf, type_t const &value) noexcept {
+    return formatter<type_t>::place(buf, value);
+}
+
+template <typename type_t>
+constexpr if_formatter_t<type_t, size_t> placement_size(
+    type_t const &value) noexcept {
+    if constexpr (internal::has_formatter_size<type_t>::value) {
+        return formatter<type_t>::size(value);
+    } else {
+        return formatter<type_t>::max_size;
+    }
+}
+
+// std::vector and std::array are placed as "[1, 2, 3]", std::pair and
+// std::tuple as "(1, 2)", with the default spec for every element.
+// See also pformat::join.
+//
+// They are declared here, so that the templates below find them for
+// nested containers, and defined after static_placement_size.
+namespace internal {
+template <typename type_t>
+constexpr bool is_placeable() noexcept;
+}
+
+// result_t if all value types are placeable
+template <typename result_t, typename... value_t>
+using if_placeable_t = typename std::enable_if<
+    (internal::is_placeable<value_t>() && ...), result_t>::type;
+
+template <typename value_t, typename alloc_t>
+if_placeable_t<size_t, value_t> placement_size(
+    std::vector<value_t, alloc_t> const &v) noexcept;
+
+template <typename value_t, typename alloc_t>
+if_placeable_t<char *, value_t> unsafe_place(
+    char *buf, std::vector<value_t, alloc_t> const &v) noexcept;
+
+template <typename value_t, size_t n>
+if_placeable_t<size_t, value_t> placement_size(
+    std::array<value_t, n> const &a) noexcept;
+
+template <typename value_t, size_t n>
+if_placeable_t<char *, value_t> unsafe_place(
+    char *buf, std::array<value_t, n> const &a) noexcept;
+
+template <typename first_t, typename second_t>
+if_placeable_t<size_t, first_t, second_t> placement_size(
+    std::pair<first_t, second_t> const &p) noexcept;
+
+template <typename first_t, typename second_t>
+if_placeable_t<char *, first_t, second_t> unsafe_place(
+    char *buf, std::pair<first_t, second_t> const &p) noexcept;
+
+template <typename... value_t>
+if_placeable_t<size_t, value_t...> placement_size(
+    std::tuple<value_t...> const &t) noexcept;
+
+template <typename... value_t>
+if_placeable_t<char *, value_t...> unsafe_place(
+    char *buf, std::tuple<value_t...> const &t) noexcept;
+
 namespace internal {
 // helper to check if a type can be placed.
 // In particular, it checks the availability of
@@ -227,7 +466,308 @@ constexpr bool is_placeable() noexcept {
 static_assert(is_placeable<int>());
 static_assert(is_placeable<char const *>());
 static_assert(is_placeable<bool>());
-static_assert(!is_placeable<std::vector<int>>());
+static_assert(is_placeable<std::vector<int>>());
+
+template <typename = void, typename... Args>
+struct exact_size_test : std::false_type {};
+
+template <typename... Args>
+struct exact_size_test<
+    std::void_t<decltype(exact_size(std::declval<Args>()...))>, Args...>
+    : std::true_type {};
+
+// the number of characters value will take when placed.
+// exact for all types with an exact_size, an upper bound otherwise.
+template <typename type_t>
+inline size_t measure(type_t const &value) noexcept {
+    if constexpr (exact_size_test<void, type_t const &>::value) {
+        return exact_size(value);
+    } else {
+        return placement_size(value);
+    }
+}
+
+// the type an argument is measured and placed as.
+//
+// C strings are measured as string_view, so that their length
+// is only computed once. All other arguments are used as is.
+template <typename arg_t>
+using measured_t = typename std::conditional<
+    std::is_same<typename std::decay<arg_t>::type, char const *>::value ||
+        std::is_same<typename std::decay<arg_t>::type, char *>::value,
+    std::string_view, typename std::remove_reference<arg_t>::type const &>::type;
+
+}  // namespace internal
+
+// static_placement_size<type_t>::value is the placement_size of every value
+// of type_t. It is only defined for types whose placement size does not
+// depend on the value: integers, bools, chars, enums, floating point
+// numbers, arrays, pairs and tuples of those, and types with a
+// formatter with a max_size.
+template <typename type_t, typename = void>
+struct static_placement_size {};
+
+template <typename type_t>
+struct static_placement_size<
+    type_t, typename std::enable_if<std::is_arithmetic<type_t>::value ||
+                                    std::is_enum<type_t>::value>::type>
+    : std::integral_constant<size_t, placement_size(type_t{})> {};
+
+template <typename float_t>
+struct static_placement_size<shortest_float<float_t>>
+    : std::integral_constant<size_t,
+                             internal::shortest_placement_size<float_t>()> {};
+
+// types with a formatter with a max_size
+template <typename type_t>
+struct static_placement_size<
+    type_t, typename std::enable_if<
+                internal::has_formatter<type_t>::value &&
+                internal::has_formatter_max_size<type_t>::value>::type>
+    : std::integral_constant<size_t, formatter<type_t>::max_size> {};
+
+namespace internal {
+
+template <typename type_t, typename = void>
+struct has_static_placement_size : std::false_type {};
+
+template <typename type_t>
+struct has_static_placement_size<
+    type_t, std::void_t<decltype(static_placement_size<type_t>::value)>>
+    : std::true_type {};
+
+static_assert(static_placement_size<int8_t>::value == 4);
+static_assert(static_placement_size<bool>::value == 5);
+static_assert(static_placement_size<char>::value == 1);
+static_assert(has_static_placement_size<double>::value);
+static_assert(!has_static_placement_size<std::string>::value);
+
+// the characters of the separators and brackets of count elements
+constexpr size_t range_frame_size(size_t count, size_t separator,
+                                  size_t brackets) noexcept {
+    return brackets + (count == 0 ? 0 : (count - 1) * separator);
+}
+
+// upper bound of the characters of count elements starting at it,
+// without separators and brackets. One multiplication for elements with
+// a static_placement_size.
+template <typename value_t, typename iterator_t>
+inline size_t range_elements_size(iterator_t it, size_t count) noexcept {
+    if constexpr (has_static_placement_size<value_t>::value) {
+        return count * static_placement_size<value_t>::value;
+    } else {
+        using placement::placement_size;
+        size_t size = 0;
+        for (size_t i = 0; i < count; ++i, ++it) {
+            value_t const &value = *it;
+            size += placement_size(value);
+        }
+        return size;
+    }
+}
+
+// places count elements starting at it with a separator of
+// separator_size_t characters, either a size_t or an integral_constant,
+// so short separators get constant-size copies
+template <typename value_t, typename iterator_t, typename separator_size_t>
+inline char *place_range_elements(char *buf, iterator_t it, size_t count,
+                                  char const *separator,
+                                  separator_size_t separator_size) noexcept {
+    using placement::unsafe_place;
+    for (size_t i = 1;; ++i, ++it) {
+        value_t const &value = *it;
+        buf = unsafe_place(buf, value);
+        if (i == count) {
+            return buf;
+        }
+        std::memcpy(buf, separator, separator_size);
+        buf += separator_size;
+    }
+}
+
+// places count elements starting at it between the brackets, separated
+// by the separator
+template <typename value_t, typename iterator_t>
+inline char *place_range(char *buf, iterator_t it, size_t count,
+                         std::string_view separator, std::string_view open,
+                         std::string_view close) noexcept {
+    std::memcpy(buf, open.data(), open.size());
+    buf += open.size();
+    if (count > 0) {
+        switch (separator.size()) {
+            case 1:
+                buf = place_range_elements<value_t>(
+                    buf, it, count, separator.data(),
+                    std::integral_constant<size_t, 1>());
+                break;
+            case 2:
+                buf = place_range_elements<value_t>(
+                    buf, it, count, separator.data(),
+                    std::integral_constant<size_t, 2>());
+                break;
+            default:
+                buf = place_range_elements<value_t>(
+                    buf, it, count, separator.data(), separator.size());
+        }
+    }
+    std::memcpy(buf, close.data(), close.size());
+    return buf + close.size();
+}
+
+// the separator and brackets of the standard containers and tuples
+inline constexpr std::string_view range_separator = ", ";
+inline constexpr std::string_view sequence_brackets = "[]";
+inline constexpr std::string_view tuple_brackets = "()";
+
+template <typename tuple_t, size_t... i>
+inline size_t tuple_placement_size(tuple_t const &t,
+                                   std::index_sequence<i...>) noexcept {
+    using placement::placement_size;
+    return range_frame_size(sizeof...(i), range_separator.size(),
+                            tuple_brackets.size()) +
+           (size_t{0} + ... + placement_size(std::get<i>(t)));
+}
+
+template <typename tuple_t, size_t... i>
+inline char *place_tuple(char *buf, tuple_t const &t,
+                         std::index_sequence<i...>) noexcept {
+    using placement::unsafe_place;
+    *buf++ = tuple_brackets[0];
+    ((buf = i == 0 ? buf : place_literal<2>(buf, range_separator.data()),
+      buf = unsafe_place(buf, std::get<i>(t))),
+     ...);
+    *buf++ = tuple_brackets[1];
+    return buf;
+}
+
+}  // namespace internal
+
+// arrays, pairs and tuples of elements with a static_placement_size
+template <typename value_t, size_t n>
+struct static_placement_size<
+    std::array<value_t, n>,
+    typename std::enable_if<
+        internal::has_static_placement_size<value_t>::value>::type>
+    : std::integral_constant<
+          size_t, n * static_placement_size<value_t>::value +
+                      internal::range_frame_size(
+                          n, internal::range_separator.size(),
+                          internal::sequence_brackets.size())> {};
+
+template <typename... value_t>
+struct static_placement_size<
+    std::tuple<value_t...>,
+    typename std::enable_if<(
+        internal::has_static_placement_size<value_t>::value && ...)>::type>
+    : std::integral_constant<
+          size_t, (size_t{0} + ... + static_placement_size<value_t>::value) +
+                      internal::range_frame_size(
+                          sizeof...(value_t), internal::range_separator.size(),
+                          internal::tuple_brackets.size())> {};
+
+template <typename first_t, typename second_t>
+struct static_placement_size<std::pair<first_t, second_t>>
+    : static_placement_size<std::tuple<first_t, second_t>> {};
+
+template <typename value_t, typename alloc_t>
+if_placeable_t<size_t, value_t> placement_size(
+    std::vector<value_t, alloc_t> const &v) noexcept {
+    return internal::range_frame_size(v.size(),
+                                      internal::range_separator.size(),
+                                      internal::sequence_brackets.size()) +
+           internal::range_elements_size<value_t>(v.begin(), v.size());
+}
+
+template <typename value_t, typename alloc_t>
+if_placeable_t<char *, value_t> unsafe_place(
+    char *buf, std::vector<value_t, alloc_t> const &v) noexcept {
+    return internal::place_range<value_t>(
+        buf, v.begin(), v.size(), internal::range_separator,
+        internal::sequence_brackets.substr(0, 1),
+        internal::sequence_brackets.substr(1));
+}
+
+template <typename value_t, size_t n>
+if_placeable_t<size_t, value_t> placement_size(
+    std::array<value_t, n> const &a) noexcept {
+    return internal::range_frame_size(n, internal::range_separator.size(),
+                                      internal::sequence_brackets.size()) +
+           internal::range_elements_size<value_t>(a.begin(), n);
+}
+
+template <typename value_t, size_t n>
+if_placeable_t<char *, value_t> unsafe_place(
+    char *buf, std::array<value_t, n> const &a) noexcept {
+    return internal::place_range<value_t>(
+        buf, a.begin(), n, internal::range_separator,
+        internal::sequence_brackets.substr(0, 1),
+        internal::sequence_brackets.substr(1));
+}
+
+template <typename first_t, typename second_t>
+if_placeable_t<size_t, first_t, second_t> placement_size(
+    std::pair<first_t, second_t> const &p) noexcept {
+    return internal::tuple_placement_size(p, std::index_sequence<0, 1>());
+}
+
+template <typename first_t, typename second_t>
+if_placeable_t<char *, first_t, second_t> unsafe_place(
+    char *buf, std::pair<first_t, second_t> const &p) noexcept {
+    return internal::place_tuple(buf, p, std::index_sequence<0, 1>());
+}
+
+template <typename... value_t>
+if_placeable_t<size_t, value_t...> placement_size(
+    std::tuple<value_t...> const &t) noexcept {
+    return internal::tuple_placement_size(
+        t, std::index_sequence_for<value_t...>());
+}
+
+template <typename... value_t>
+if_placeable_t<char *, value_t...> unsafe_place(
+    char *buf, std::tuple<value_t...> const &t) noexcept {
+    return internal::place_tuple(buf, t,
+                                 std::index_sequence_for<value_t...>());
+}
+
+// wrapper to place count elements starting at begin with a separator
+// and brackets, see pformat::join
+template <typename iterator_t>
+struct joined_range {
+    using value_t = typename std::iterator_traits<iterator_t>::value_type;
+
+    iterator_t begin;
+    size_t count;
+    std::string_view separator;
+    std::string_view open;
+    std::string_view close;
+};
+
+template <typename iterator_t>
+if_placeable_t<size_t, typename joined_range<iterator_t>::value_t>
+placement_size(joined_range<iterator_t> const &r) noexcept {
+    using value_t = typename joined_range<iterator_t>::value_t;
+    return internal::range_frame_size(r.count, r.separator.size(),
+                                      r.open.size() + r.close.size()) +
+           internal::range_elements_size<value_t>(r.begin, r.count);
+}
+
+template <typename iterator_t>
+if_placeable_t<char *, typename joined_range<iterator_t>::value_t>
+unsafe_place(char *buf, joined_range<iterator_t> const &r) noexcept {
+    using value_t = typename joined_range<iterator_t>::value_t;
+    return internal::place_range<value_t>(buf, r.begin, r.count,
+                                          r.separator, r.open, r.close);
+}
+
+namespace internal {
+
+static_assert(static_placement_size<std::array<int8_t, 3>>::value ==
+              3 * 4 + 2 * 2 + 2);  // [-128, -128, -128]
+static_assert(static_placement_size<std::pair<bool, char>>::value ==
+              5 + 1 + 2 + 2);  // (false, c)
+static_assert(!has_static_placement_size<std::vector<int>>::value);
+static_assert(!has_static_placement_size<std::tuple<int, std::string>>::value);
 
 template <typename type_t, typename... type_rest_t>
 constexpr bool test_placements_helper() {
@@ -253,23 +793,338 @@ constexpr bool test_placements() {
     }
 }
 
+namespace internal {
+
+static_assert(pformat::internal::max_spec_precision == max_fixed_precision);
+
+// integers that can be placed in hex ('x', 'X') or decimal ('d')
+template <typename type_t>
+constexpr bool is_spec_integer() noexcept {
+    return std::is_integral<type_t>::value &&
+           !std::is_same<type_t, bool>::value &&
+           !std::is_same<type_t, char>::value;
+}
+
+template <typename type_t>
+constexpr bool is_spec_float() noexcept {
+    return std::is_same<type_t, float>::value ||
+           std::is_same<type_t, double>::value;
+}
+
+// numbers are right aligned by default and can be padded with zeros
+template <typename type_t>
+constexpr bool is_spec_number() noexcept {
+    return is_spec_integer<type_t>() || is_spec_float<type_t>() ||
+           std::is_same<type_t, shortest_float<float>>::value ||
+           std::is_same<type_t, shortest_float<double>>::value;
+}
+
+// returns true if the spec can be used for values of type_t
+template <typename type_t>
+constexpr bool is_valid_spec(format_spec const &spec) noexcept {
+    if constexpr (std::is_enum<type_t>::value) {
+        return is_valid_spec<typename std::underlying_type<type_t>::type>(
+            spec);
+    } else {
+        if ((spec.type == 'x' || spec.type == 'X' || spec.type == 'd') &&
+            !is_spec_integer<type_t>()) {
+            return false;
+        }
+        if ((spec.type == 'f' || spec.precision >= 0) &&
+            !is_spec_float<type_t>()) {
+            return false;
+        }
+        return !spec.zero || is_spec_number<type_t>();
+    }
+}
+
+template <typename int_t>
+inline auto spec_abs(int_t value) noexcept {
+    using uint_t = kernel_uint_t<int_t>;
+    uint_t abs_value = static_cast<uint_t>(value);
+    if constexpr (std::is_signed<int_t>::value) {
+        if (value < 0) {
+            abs_value = uint_t() - abs_value;
+        }
+    }
+    return abs_value;
+}
+
+// places the value as the type and precision of the spec ask for,
+// without padding
+template <typename type_t>
+inline char *place_spec_value(char *buf, type_t const &value,
+                              format_spec const &spec) noexcept {
+    if constexpr (is_spec_integer<type_t>()) {
+        if (spec.type == 'x' || spec.type == 'X') {
+            if constexpr (std::is_signed<type_t>::value) {
+                if (value < 0) {
+                    *buf++ = '-';
+                }
+            }
+            return spec.type == 'x' ? place_hex<false>(buf, spec_abs(value))
+                                    : place_hex<true>(buf, spec_abs(value));
+        }
+    } else if constexpr (is_spec_float<type_t>()) {
+        if (spec.precision >= 0) {
+            return place_fixed(buf, value, spec.precision);
+        }
+    }
+    using placement::unsafe_place;
+    return unsafe_place(buf, value);
+}
+
+// pads the placed value in [buf, end) to the width of the spec
+inline char *place_spec_padding(char *buf, char *end, format_spec const &spec,
+                                bool number) noexcept {
+    size_t const size = end - buf;
+    if (size >= spec.width) {
+        return end;
+    }
+    size_t const padding = spec.width - size;
+    char fill = spec.fill;
+    char align = spec.align;
+    if (align == 0) {
+        align = number ? '>' : '<';
+        // zeros go after the sign, inf and nan are padded with spaces
+        size_t const sign = size > 0 && buf[0] == '-';
+        if (spec.zero && number && size > sign && buf[sign] != 'i' &&
+            buf[sign] != 'n') {
+            std::memmove(buf + sign + padding, buf + sign, size - sign);
+            std::memset(buf + sign, '0', padding);
+            return buf + spec.width;
+        }
+        if (spec.zero) {
+            fill = ' ';
+        }
+    }
+    size_t const before =
+        align == '>' ? padding : align == '^' ? padding / 2 : 0;
+    std::memmove(buf + before, buf, size);
+    std::memset(buf, fill, before);
+    std::memset(buf + before + size, fill, padding - before);
+    return buf + spec.width;
+}
+
+/**
+ * places a value formatted with a spec.
+ *
+ * The spec has to be valid for the type, see is_valid_spec.
+ * Used with a constant spec by log_config, where the checks fold away,
+ * and with the spec of a site by the binary log decoder.
+ */
+template <typename type_t>
+inline char *place_with_spec(char *buf, type_t const &value,
+                             format_spec const &spec) noexcept {
+    if constexpr (std::is_enum<type_t>::value) {
+        using int_t = typename std::underlying_type<type_t>::type;
+        return place_with_spec(buf, static_cast<int_t>(value), spec);
+    } else {
+        char *end = place_spec_value(buf, value, spec);
+        if (spec.width == 0) {
+            return end;
+        }
+        return place_spec_padding(buf, end, spec, is_spec_number<type_t>());
+    }
+}
+
+// number of characters of an integer placed in hex
+template <typename int_t>
+inline size_t hex_size(int_t value) noexcept {
+    if constexpr (std::is_signed<int_t>::value) {
+        return count_hex_digits(spec_abs(value)) + (value < 0);
+    } else {
+        return count_hex_digits(spec_abs(value));
+    }
+}
+
+template <typename int_t>
+constexpr size_t max_hex_size() noexcept {
+    return 2 * sizeof(int_t) + std::is_signed<int_t>::value;
+}
+
+// the number of characters a value formatted with a spec takes.
+// exact if measure(value) is exact.
+template <typename type_t>
+inline size_t measure_with_spec(type_t const &value,
+                                format_spec const &spec) noexcept {
+    size_t size;
+    if constexpr (std::is_enum<type_t>::value) {
+        using int_t = typename std::underlying_type<type_t>::type;
+        return measure_with_spec(static_cast<int_t>(value), spec);
+    } else if constexpr (is_spec_integer<type_t>()) {
+        size = spec.type == 'x' || spec.type == 'X' ? hex_size(value)
+                                                    : measure(value);
+    } else if constexpr (is_spec_float<type_t>()) {
+        size = spec.precision >= 0
+                   ? fixed_placement_size<type_t>(spec.precision)
+                   : measure(value);
+    } else {
+        size = measure(value);
+    }
+    return std::max<size_t>(size, spec.width);
+}
+
+// upper bound of the characters a value formatted with a spec takes
+template <typename type_t>
+inline size_t placement_size_with_spec(type_t const &value,
+                                       format_spec const &spec) noexcept {
+    size_t size;
+    if constexpr (std::is_enum<type_t>::value) {
+        using int_t = typename std::underlying_type<type_t>::type;
+        return placement_size_with_spec(static_cast<int_t>(value), spec);
+    } else if constexpr (is_spec_integer<type_t>()) {
+        size = spec.type == 'x' || spec.type == 'X' ? max_hex_size<type_t>()
+                                                    : placement_size(value);
+    } else if constexpr (is_spec_float<type_t>()) {
+        size = spec.precision >= 0
+                   ? fixed_placement_size<type_t>(spec.precision)
+                   : placement_size(value);
+    } else {
+        using placement::placement_size;
+        size = placement_size(value);
+    }
+    return std::max<size_t>(size, spec.width);
+}
+
+// static_placement_size of type_t formatted with a spec
+template <typename type_t>
+constexpr size_t static_placement_size_with_spec(
+    format_spec const &spec) noexcept {
+    if constexpr (std::is_enum<type_t>::value) {
+        using int_t = typename std::underlying_type<type_t>::type;
+        return static_placement_size_with_spec<int_t>(spec);
+    } else {
+        size_t size = static_placement_size<type_t>::value;
+        if constexpr (is_spec_integer<type_t>()) {
+            if (spec.type == 'x' || spec.type == 'X') {
+                size = max_hex_size<type_t>();
+            }
+        } else if constexpr (is_spec_float<type_t>()) {
+            if (spec.precision >= 0) {
+                size = fixed_placement_size<type_t>(spec.precision);
+            }
+        }
+        return std::max<size_t>(size, spec.width);
+    }
+}
+
+static_assert(static_placement_size_with_spec<uint32_t>({'0', 0, true, 'x', 8,
+                                                         -1}) == 8);
+static_assert(static_placement_size_with_spec<int8_t>({' ', '>', false, 0, 10,
+                                                       -1}) == 10);
+
+// the placement functions for a spec_constant.
+//
+// The default spec uses the plain placement functions.
+template <typename spec_t, typename type_t>
+inline char *place_spec(char *buf, type_t const &value) {
+    constexpr format_spec spec = spec_t::value;
+    if constexpr (spec.is_default()) {
+        using placement::unsafe_place;
+        return unsafe_place(buf, value);
+    } else {
+        static_assert(is_valid_spec<type_t>(spec),
+                      "Format spec does not match the argument type");
+        return place_with_spec(buf, value, spec);
+    }
+}
+
+template <typename spec_t, typename type_t>
+inline size_t measure_spec(type_t const &value) noexcept {
+    constexpr format_spec spec = spec_t::value;
+    if constexpr (spec.is_default()) {
+        return measure(value);
+    } else {
+        return measure_with_spec(value, spec);
+    }
+}
+
+template <typename spec_t, typename type_t>
+inline size_t placement_size_spec(type_t const &value) noexcept {
+    constexpr format_spec spec = spec_t::value;
+    if constexpr (spec.is_default()) {
+        using placement::placement_size;
+        return placement_size(value);
+    } else {
+        return placement_size_with_spec(value, spec);
+    }
+}
+
+template <typename spec_t, typename type_t>
+constexpr size_t static_placement_size_spec() noexcept {
+    constexpr format_spec spec = spec_t::value;
+    if constexpr (spec.is_default()) {
+        return static_placement_size<type_t>::value;
+    } else {
+        return static_placement_size_with_spec<type_t>(spec);
+    }
+}
+
+// the largest prefix of s with at most n characters that does not end
+// within a UTF-8 sequence. n has to be smaller than s.size().
+inline size_t utf8_prefix_size(std::string_view s, size_t n) noexcept {
+    while (n > 0 && (static_cast<unsigned char>(s[n]) & 0xC0) == 0x80) {
+        --n;
+    }
+    return n;
+}
+
+// places value into at most n characters of buf and returns the end of
+// the output.
+//
+// Strings with the default spec are cut at a character boundary if they
+// do not fit. All other values are placed completely or not at all.
+// truncated is set if the value was cut or left out.
+template <typename spec_t, typename type_t>
+inline char *place_spec_n(char *buf, size_t n, type_t const &value,
+                          bool &truncated) {
+    if (measure_spec<spec_t>(value) <= n) {
+        return place_spec<spec_t>(buf, value);
+    }
+    if constexpr (spec_t::value.is_default() &&
+                  (std::is_same<type_t, std::string>::value ||
+                   std::is_same<type_t, std::string_view>::value)) {
+        std::string_view const s{value};
+        n = utf8_prefix_size(s, n);
+        std::memcpy(buf, s.data(), n);
+        buf += n;
+    } else if constexpr (has_static_placement_size<type_t>::value) {
+        // the measured size of e.g. doubles is only an upper bound
+        char tmp[static_placement_size_spec<spec_t, type_t>()];
+        char *end = place_spec<spec_t>(tmp, value);
+        if (static_cast<size_t>(end - tmp) <= n) {
+            std::memcpy(buf, tmp, end - tmp);
+            return buf + (end - tmp);
+        }
+    }
+    truncated = true;
+    return buf;
+}
+
+}  // namespace internal
+
 };  // namespace placement
 
+// wrapper to place a pointer as 0x followed by its hex digits,
+// see any
 template <typename pointer_t>
-struct pointer_format_extention final : placement::format_extention {
+struct pointer_format_extention {
     const pointer_t p;
 
     constexpr pointer_format_extention(pointer_t p_) : p(p_) {}
+};
 
-    inline size_t placement_size() const override {
-        return placement::placement_size<size_t>({}) + 2;
-    }
+template <typename pointer_t>
+struct formatter<pointer_format_extention<pointer_t>> {
+    static constexpr size_t max_size = 2 + 2 * sizeof(size_t);
 
-    inline char *unsafe_place(char *buf) const override {
+    static char *place(char *buf,
+                       pointer_format_extention<pointer_t> const &v) noexcept {
         buf[0] = '0';
         buf[1] = 'x';
-        const size_t v = reinterpret_cast<size_t>(p);
-        return placement::unsafe_place<size_t, 16>(buf + 2, v);
+        const size_t p = reinterpret_cast<size_t>(v.p);
+        return placement::unsafe_place<size_t, 16>(buf + 2, p);
     }
 };
 
@@ -279,4 +1134,42 @@ auto any(value_t *p) {
     return pointer_format_extention<pointer_t>(p);
 }
 
+// places a round-trip representation (Grisu2) of a float or double
+// that reads back as the same value, e.g. 0.1 instead of 0.100000.
+template <typename float_t,
+          typename std::enable_if<std::is_same<float_t, float>::value ||
+                                  std::is_same<float_t, double>::value>::type
+              * = nullptr>
+constexpr auto shortest(float_t value) noexcept {
+    return placement::shortest_float<float_t>{value};
+}
+
+// places the elements of a range, e.g. a std::vector, a std::set or a
+// span-like view, separated by the separator and between the brackets
+// open and close: join(ids, "|") places "1|2|3" and
+// join(ids, ", ", "{", "}") "{1, 2, 3}".
+//
+// The elements are read when they are placed, they have to stay valid
+// until then.
+template <typename range_t>
+auto join(range_t const &range, std::string_view separator = ", ",
+          std::string_view open = "", std::string_view close = "") {
+    using std::begin;
+    using std::end;
+    using iterator_t = decltype(begin(range));
+    return placement::joined_range<iterator_t>{
+        begin(range),
+        static_cast<size_t>(std::distance(begin(range), end(range))),
+        separator, open, close};
+}
+
+// places count elements starting at data, see join
+template <typename value_t>
+auto join(value_t const *data, size_t count,
+          std::string_view separator = ", ", std::string_view open = "",
+          std::string_view close = "") noexcept {
+    return placement::joined_range<value_t const *>{data, count, separator,
+                                                    open, close};
+}
+
 }  // namespace pformat
\ No newline at end of file
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace pformat {
+
+// the format spec of a parameter, e.g. {:>10} or {:08x}
+//
+// Syntax: [[fill]align][0][width][.precision][type]
+//   fill: any ASCII character except '{' and '}'
+//   align: '<' (left), '>' (right) or '^' (center).
+//          Numbers are right aligned by default, all other types left.
+//   0: pads numbers with zeros after the sign
+//   width: minimal number of characters
+//   precision: number of fractional digits of a float or double
+//   type: 'x' or 'X' for hex integers, 'd' for decimal integers and
+//         'f' for fixed floating point numbers
+struct format_spec {
+    char fill = ' ';
+    // 0 for the default alignment of the argument type
+    char align = 0;
+    bool zero = false;
+    // 0 for the default
+    char type = 0;
+    uint32_t width = 0;
+    // -1 for the default
+    int32_t precision = -1;
+
+    constexpr bool is_default() const noexcept {
+        return fill == ' ' && align == 0 && !zero && type == 0 && width == 0 &&
+               precision == -1;
+    }
+};
+
+namespace internal {
+
+// largest width of a format spec
+constexpr uint32_t max_spec_width = 4096;
+
+// largest precision of a format spec, see placement::internal::place_fixed
+constexpr int32_t max_spec_precision = 19;
+
+// a format spec as a type, so it can be part of a format_parameter
+template <char fill, char align, bool zero, char type, uint32_t width,
+          int32_t precision>
+struct spec_constant {
+    static constexpr format_spec value{fill, align, zero, type, width,
+                                       precision};
+};
+
+using default_spec = spec_constant<' ', 0, false, 0, 0, -1>;
+
+struct spec_parse_result {
+    format_spec spec;
+    bool valid;
+    // offset of the closing '}'
+    size_t end;
+};
+
+constexpr bool is_spec_align(char c) noexcept {
+    return c == '<' || c == '>' || c == '^';
+}
+
+constexpr bool is_spec_digit(char c) noexcept { return c >= '0' && c <= '9'; }
+
+// parses the format spec starting at str[n] (after the ':') up to the
+// closing '}'. str has to be zero terminated.
+constexpr spec_parse_result parse_spec(char const *str, size_t n) noexcept {
+    spec_parse_result result{{}, false, n};
+    auto &spec = result.spec;
+    char const c = str[n];
+    if (c != 0 && c != '{' && c != '}' && is_spec_align(str[n + 1])) {
+        if (static_cast<unsigned char>(c) >= 0x80) {
+            return result;
+        }
+        spec.fill = c;
+        spec.align = str[n + 1];
+        n += 2;
+    } else if (is_spec_align(c)) {
+        spec.align = c;
+        n++;
+    }
+    if (str[n] == '0') {
+        spec.zero = true;
+        n++;
+    }
+    for (; is_spec_digit(str[n]); ++n) {
+        spec.width = spec.width * 10 + (str[n] - '0');
+        if (spec.width > max_spec_width) {
+            return result;
+        }
+    }
+    if (str[n] == '.') {
+        n++;
+        if (!is_spec_digit(str[n])) {
+            return result;
+        }
+        spec.precision = 0;
+        for (; is_spec_digit(str[n]); ++n) {
+            spec.precision = spec.precision * 10 + (str[n] - '0');
+            if (spec.precision > max_spec_precision) {
+                return result;
+            }
+        }
+    }
+    if (str[n] == 'x' || str[n] == 'X' || str[n] == 'd' || str[n] == 'f') {
+        spec.type = str[n];
+        n++;
+    }
+    if (str[n] != '}') {
+        return result;
+    }
+    if (spec.precision >= 0 && spec.type != 0 && spec.type != 'f') {
+        return result;
+    }
+    result.valid = true;
+    result.end = n;
+    return result;
+}
+
+static_assert(parse_spec(":}", 1).valid);
+static_assert(parse_spec(":}", 1).spec.is_default());
+static_assert(parse_spec(":08x}", 1).spec.width == 8);
+static_assert(parse_spec(":08x}", 1).spec.zero);
+static_assert(parse_spec("*^6}", 0).spec.fill == '*');
+static_assert(parse_spec(".3f}", 0).spec.precision == 3);
+static_assert(parse_spec(".19f}", 0).valid);
+static_assert(!parse_spec(".20f}", 0).valid);
+static_assert(!parse_spec(".3x}", 0).valid);
+static_assert(!parse_spec(".}", 0).valid);
+static_assert(!parse_spec("a}", 0).valid);
+static_assert(!parse_spec("10", 0).valid);
+
+}  // namespace internal
+
+}  // namespace pformat
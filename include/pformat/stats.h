@@ -0,0 +1,390 @@
+#pragma once
+
+// Per-site instrumentation of format calls.
+//
+// Define PFORMAT_ENABLE_STATS to count the calls, the produced bytes and
+// the overestimation of the measured size bound of every format site,
+// and to sample the cycles of every PFORMAT_STATS_SAMPLE_INTERVAL-th call
+// of a site per thread. Without it all hooks are empty.
+//
+// The counters are sharded per thread, so counting never contends.
+// dump_stats lists the sites ranked by their estimated cycles.
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+#ifdef PFORMAT_ENABLE_STATS
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+#endif
+
+#include "capture.h"
+
+#ifndef PFORMAT_STATS_SAMPLE_INTERVAL
+#define PFORMAT_STATS_SAMPLE_INTERVAL 64
+#endif
+
+namespace pformat {
+namespace stats {
+
+// number of power of two buckets of the cycle histogram
+constexpr size_t histogram_buckets = 40;
+
+// the counters of a site summed over all threads
+struct site_summary {
+    binary::site const *site = nullptr;
+    uint64_t calls = 0;
+    uint64_t bytes = 0;
+    // calls which measured the output before placing it, and the sum
+    // of the measured size minus the actual size
+    uint64_t measured_calls = 0;
+    uint64_t overestimation = 0;
+    // sampled calls and their cycles
+    uint64_t samples = 0;
+    uint64_t sampled_cycles = 0;
+    // samples[i] took less than 2^(i+1) cycles
+    uint64_t histogram[histogram_buckets] = {};
+
+    // estimated cycles of all calls
+    uint64_t estimated_cycles() const noexcept {
+        return samples == 0 ? 0
+                            : static_cast<uint64_t>(
+                                  static_cast<double>(sampled_cycles) /
+                                  samples * calls);
+    }
+
+    // upper bound of the cycles of the given fraction of the samples,
+    // e.g. 0.99 for the 99th percentile
+    uint64_t percentile_cycles(double fraction) const noexcept {
+        uint64_t const target = static_cast<uint64_t>(fraction * samples);
+        uint64_t count = 0;
+        for (size_t i = 0; i < histogram_buckets; ++i) {
+            count += histogram[i];
+            if (count > target) {
+                return uint64_t(2) << i;
+            }
+        }
+        return 0;
+    }
+};
+
+#ifdef PFORMAT_ENABLE_STATS
+
+namespace internal {
+
+inline uint64_t cycles() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+// the counters of a site in a single thread. Only the owning thread
+// writes them, so relaxed loads and stores suffice.
+struct site_counters {
+    std::atomic<uint64_t> calls{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> measured_calls{0};
+    std::atomic<uint64_t> overestimation{0};
+    std::atomic<uint64_t> samples{0};
+    std::atomic<uint64_t> sampled_cycles{0};
+    std::atomic<uint64_t> histogram[histogram_buckets] = {};
+
+    static void add(std::atomic<uint64_t> &counter, uint64_t value) noexcept {
+        counter.store(counter.load(std::memory_order_relaxed) + value,
+                      std::memory_order_relaxed);
+    }
+
+    void add_to(site_summary &s) const noexcept {
+        s.calls += calls.load(std::memory_order_relaxed);
+        s.bytes += bytes.load(std::memory_order_relaxed);
+        s.measured_calls += measured_calls.load(std::memory_order_relaxed);
+        s.overestimation += overestimation.load(std::memory_order_relaxed);
+        s.samples += samples.load(std::memory_order_relaxed);
+        s.sampled_cycles += sampled_cycles.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < histogram_buckets; ++i) {
+            s.histogram[i] += histogram[i].load(std::memory_order_relaxed);
+        }
+    }
+};
+
+// the counters of all sites of a thread, indexed by site_stats::index.
+//
+// Blocks of counters are allocated on first use and never move, so
+// dump_stats can read them while the thread counts.
+class thread_shard {
+   public:
+    static constexpr size_t block_size = 64;
+    static constexpr size_t max_blocks = 1024;
+
+    ~thread_shard() {
+        for (auto &block : blocks) {
+            delete[] block.load(std::memory_order_relaxed);
+        }
+    }
+
+    // the counters of the site with the index. At most
+    // block_size * max_blocks sites are counted, nullptr for the others.
+    site_counters *counters(size_t index) {
+        if (index >= block_size * max_blocks) {
+            return nullptr;
+        }
+        auto &block = blocks[index / block_size];
+        site_counters *b = block.load(std::memory_order_relaxed);
+        if (b == nullptr) {
+            b = new site_counters[block_size];
+            block.store(b, std::memory_order_release);
+        }
+        return b + index % block_size;
+    }
+
+    // nullptr if the thread never counted the site
+    site_counters const *find(size_t index) const noexcept {
+        if (index >= block_size * max_blocks) {
+            return nullptr;
+        }
+        site_counters const *b =
+            blocks[index / block_size].load(std::memory_order_acquire);
+        return b == nullptr ? nullptr : b + index % block_size;
+    }
+
+   private:
+    std::atomic<site_counters *> blocks[max_blocks] = {};
+};
+
+// all shards ever used. A shard of an exited thread keeps its counts
+// and is reused by the next new thread.
+struct shard_pool {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<thread_shard>> shards;
+    std::vector<thread_shard *> unused;
+
+    thread_shard *acquire() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!unused.empty()) {
+            thread_shard *s = unused.back();
+            unused.pop_back();
+            return s;
+        }
+        shards.push_back(std::make_unique<thread_shard>());
+        return shards.back().get();
+    }
+
+    void release(thread_shard *s) {
+        std::lock_guard<std::mutex> lock(mutex);
+        unused.push_back(s);
+    }
+};
+
+// never destroyed, threads may exit after static destruction started
+inline shard_pool &pool() {
+    static shard_pool *p = new shard_pool;
+    return *p;
+}
+
+struct shard_handle {
+    thread_shard *shard = pool().acquire();
+
+    ~shard_handle() { pool().release(shard); }
+};
+
+inline thread_shard &local_shard() {
+    thread_local shard_handle handle;
+    return *handle.shard;
+}
+
+}  // namespace internal
+
+// the statistics of a site. Every site gets a dense index during static
+// initialization.
+struct site_stats {
+    binary::site const &stats_site;
+    size_t const index;
+    site_stats const *next;
+
+    explicit site_stats(binary::site const &s) noexcept
+        : stats_site(s), index(head_and_count().count.fetch_add(1)),
+          next(nullptr) {
+        auto &head = head_and_count().head;
+        next = head.load(std::memory_order_relaxed);
+        while (!head.compare_exchange_weak(next, this,
+                                           std::memory_order_release,
+                                           std::memory_order_relaxed)) {
+        }
+    }
+
+    struct registry {
+        std::atomic<site_stats const *> head{nullptr};
+        std::atomic<size_t> count{0};
+    };
+
+    static registry &head_and_count() noexcept {
+        static registry r;
+        return r;
+    }
+};
+
+/**
+ * counts a single format call of a site, see log_config::format.
+ */
+class call_scope {
+   public:
+    explicit call_scope(site_stats const &s)
+        : counters(internal::local_shard().counters(s.index)) {
+        if (counters == nullptr) {
+            return;
+        }
+        uint64_t const calls =
+            counters->calls.load(std::memory_order_relaxed);
+        counters->calls.store(calls + 1, std::memory_order_relaxed);
+        if (calls % PFORMAT_STATS_SAMPLE_INTERVAL == 0) {
+            start = internal::cycles();
+            sampled = true;
+        }
+    }
+
+    // the call produced bytes characters
+    void finish(size_t bytes) noexcept {
+        if (counters == nullptr) {
+            return;
+        }
+        if (sampled) {
+            uint64_t const cycles = internal::cycles() - start;
+            int const bucket = cycles < 2 ? 0 : 63 - __builtin_clzll(cycles);
+            internal::site_counters::add(counters->samples, 1);
+            internal::site_counters::add(counters->sampled_cycles, cycles);
+            internal::site_counters::add(
+                counters->histogram[std::min<size_t>(bucket,
+                                                    histogram_buckets - 1)],
+                1);
+        }
+        internal::site_counters::add(counters->bytes, bytes);
+    }
+
+    // the call measured measured characters and produced bytes
+    void finish(size_t bytes, size_t measured) noexcept {
+        if (counters == nullptr) {
+            return;
+        }
+        internal::site_counters::add(counters->measured_calls, 1);
+        internal::site_counters::add(counters->overestimation,
+                                     measured - bytes);
+        finish(bytes);
+    }
+
+   private:
+    // nullptr for sites past the supported number of sites
+    internal::site_counters *counters;
+    uint64_t start = 0;
+    bool sampled = false;
+};
+
+constexpr bool enabled = true;
+
+/**
+ * returns the counters of all sites called at least once, summed over
+ * all threads and ranked by their estimated cycles.
+ */
+inline std::vector<site_summary> collect_stats() {
+    std::vector<site_summary> summaries;
+    auto &pool = internal::pool();
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    for (auto *s = site_stats::head_and_count().head.load(
+             std::memory_order_acquire);
+         s != nullptr; s = s->next) {
+        site_summary summary;
+        summary.site = &s->stats_site;
+        for (auto const &shard : pool.shards) {
+            if (auto const *counters = shard->find(s->index)) {
+                counters->add_to(summary);
+            }
+        }
+        if (summary.calls > 0) {
+            summaries.push_back(summary);
+        }
+    }
+    std::stable_sort(summaries.begin(), summaries.end(),
+                     [](site_summary const &a, site_summary const &b) {
+                         return a.estimated_cycles() > b.estimated_cycles();
+                     });
+    return summaries;
+}
+
+#else
+
+// empty stand-ins if PFORMAT_ENABLE_STATS is not defined
+
+struct site_stats {
+    explicit constexpr site_stats(binary::site const &) noexcept {}
+};
+
+class call_scope {
+   public:
+    call_scope() noexcept = default;
+    explicit call_scope(site_stats const &) noexcept {}
+    void finish(size_t) noexcept {}
+    void finish(size_t, size_t) noexcept {}
+};
+
+constexpr bool enabled = false;
+
+inline std::vector<site_summary> collect_stats() { return {}; }
+
+#endif
+
+/**
+ * writes the limit most expensive sites, see collect_stats.
+ *
+ * Per site: the share of the estimated cycles of all sites, the calls,
+ * the average bytes and overestimation of the size bound per call, the
+ * median and 99th percentile of the sampled cycles and the format string.
+ */
+inline void dump_stats(std::ostream &out = std::cerr, size_t limit = 20) {
+    if (!enabled) {
+        out << "pformat stats are disabled, define PFORMAT_ENABLE_STATS\n";
+        return;
+    }
+    auto const summaries = collect_stats();
+    uint64_t total = 0;
+    for (auto const &s : summaries) {
+        total += s.estimated_cycles();
+    }
+    auto const flags = out.flags();
+    auto const precision = out.precision();
+    out << std::setw(7) << "cycles%" << std::setw(13) << "calls"
+        << std::setw(10) << "bytes" << std::setw(10) << "overest"
+        << std::setw(10) << "p50" << std::setw(10) << "p99"
+        << "  format\n";
+    for (size_t i = 0; i < std::min(limit, summaries.size()); ++i) {
+        auto const &s = summaries[i];
+        double const share =
+            total == 0 ? 0 : 100.0 * s.estimated_cycles() / total;
+        out << std::fixed << std::setprecision(1) << std::setw(7) << share
+            << std::setw(13) << s.calls << std::setw(10)
+            << s.bytes / s.calls << std::setw(10)
+            << (s.measured_calls == 0 ? 0
+                                      : s.overestimation / s.measured_calls)
+            << std::setw(10) << s.percentile_cycles(0.5) << std::setw(10)
+            << s.percentile_cycles(0.99) << "  " << s.site->format << "\n";
+    }
+    out.flags(flags);
+    out.precision(precision);
+}
+
+}  // namespace stats
+
+using stats::dump_stats;
+
+}  // namespace pformat
@@ -0,0 +1,392 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "placement.h"
+
+namespace pformat {
+
+/**
+ * Structured output of a format string, see log_config::format_json and
+ * log_config::format_logfmt.
+ *
+ * The formatted message becomes the "msg" field, every named parameter,
+ * e.g. {page_id}, becomes an additional field:
+ *
+ *     "page {page_id} of {file}"_fmt.format_json(27, "a.db")
+ *     {"msg":"page 27 of a.db","page_id":27,"file":"a.db"}
+ *
+ *     "page {page_id} of {file}"_fmt.format_logfmt(27, "a.db")
+ *     msg="page 27 of a.db" page_id=27 file="a.db"
+ *
+ * Strings are escaped as JSON strings in both styles.
+ */
+namespace structured {
+
+enum class style { json, logfmt };
+
+namespace internal {
+
+// JSON escaping.
+//
+// '"', '\\' and the control characters below 0x20 are escaped, the
+// common ones as \n, \t, ..., the others as \u00XX. An escaped string
+// takes at most max_escape_size times the characters of the source.
+//
+// The vector kernels compare 16 (SSE2) or 32 (AVX2) characters at a
+// time and copy them unconditionally, the output stops at the first
+// character that needs escaping. The output bound of max_escape_size
+// characters per source character leaves room for the whole vector.
+
+constexpr size_t max_escape_size = 6;
+
+constexpr bool needs_escape(char c) noexcept {
+    return c == '"' || c == '\\' || static_cast<unsigned char>(c) < 0x20;
+}
+
+// the second character of the short escape of c, 0 if there is none
+constexpr char short_escape(char c) noexcept {
+    switch (c) {
+        case '"':
+            return '"';
+        case '\\':
+            return '\\';
+        case '\n':
+            return 'n';
+        case '\r':
+            return 'r';
+        case '\t':
+            return 't';
+        case '\b':
+            return 'b';
+        case '\f':
+            return 'f';
+        default:
+            return 0;
+    }
+}
+
+constexpr size_t escaped_size(char c) noexcept {
+    return !needs_escape(c) ? 1 : short_escape(c) != 0 ? 2 : max_escape_size;
+}
+
+constexpr size_t escaped_size(std::string_view s) noexcept {
+    size_t size = 0;
+    for (char c : s) {
+        size += escaped_size(c);
+    }
+    return size;
+}
+
+// places c, escaped if needed
+constexpr char *escape_char(char *out, char c) noexcept {
+    if (!needs_escape(c)) {
+        *out = c;
+        return out + 1;
+    }
+    out[0] = '\\';
+    if (char const e = short_escape(c)) {
+        out[1] = e;
+        return out + 2;
+    }
+    constexpr char const *digits = "0123456789abcdef";
+    auto const u = static_cast<unsigned char>(c);
+    out[1] = 'u';
+    out[2] = '0';
+    out[3] = '0';
+    out[4] = digits[u >> 4];
+    out[5] = digits[u & 0xf];
+    return out + max_escape_size;
+}
+
+static_assert(escaped_size("a\"b\\\n\x01") == 1 + 2 + 1 + 2 + 2 + 6);
+
+#if defined(__SSE2__)
+// bit i is set if in[i] needs escaping
+inline uint32_t escape_mask16(char const *in) noexcept {
+    __m128i const v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(in));
+    __m128i const control =
+        _mm_cmpeq_epi8(_mm_min_epu8(v, _mm_set1_epi8(0x1f)), v);
+    __m128i const quote = _mm_cmpeq_epi8(v, _mm_set1_epi8('"'));
+    __m128i const backslash = _mm_cmpeq_epi8(v, _mm_set1_epi8('\\'));
+    return static_cast<uint32_t>(_mm_movemask_epi8(
+        _mm_or_si128(control, _mm_or_si128(quote, backslash))));
+}
+#endif
+
+#ifdef __AVX2__
+inline uint32_t escape_mask32(char const *in) noexcept {
+    __m256i const v =
+        _mm256_loadu_si256(reinterpret_cast<__m256i const *>(in));
+    __m256i const control =
+        _mm256_cmpeq_epi8(_mm256_min_epu8(v, _mm256_set1_epi8(0x1f)), v);
+    __m256i const quote = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('"'));
+    __m256i const backslash = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\'));
+    return static_cast<uint32_t>(_mm256_movemask_epi8(
+        _mm256_or_si256(control, _mm256_or_si256(quote, backslash))));
+}
+#endif
+
+/**
+ * places the size characters at in escaped and returns the end of the
+ * output.
+ *
+ * out has to have room for max_escape_size * size characters.
+ */
+inline char *escape(char *out, char const *in, size_t size) noexcept {
+    char const *const end = in + size;
+#ifdef __AVX2__
+    while (end - in >= 32) {
+        uint32_t const mask = escape_mask32(in);
+        std::memcpy(out, in, 32);
+        if (mask == 0) {
+            in += 32;
+            out += 32;
+            continue;
+        }
+        size_t const n = __builtin_ctz(mask);
+        out = escape_char(out + n, in[n]);
+        in += n + 1;
+    }
+#endif
+#if defined(__SSE2__)
+    while (end - in >= 16) {
+        uint32_t const mask = escape_mask16(in);
+        std::memcpy(out, in, 16);
+        if (mask == 0) {
+            in += 16;
+            out += 16;
+            continue;
+        }
+        size_t const n = __builtin_ctz(mask);
+        out = escape_char(out + n, in[n]);
+        in += n + 1;
+    }
+    // the tail is checked as a whole, short strings rarely need escaping
+    if (size_t const rest = end - in; rest > 0) {
+        char tail[16] = {};
+        std::memcpy(tail, in, rest);
+        if ((escape_mask16(tail) & ((1u << rest) - 1)) == 0) {
+            std::memcpy(out, in, rest);
+            return out + rest;
+        }
+    }
+#endif
+    for (; in != end; ++in) {
+        out = escape_char(out, *in);
+    }
+    return out;
+}
+
+/**
+ * escapes the characters placed in [begin, end) in place and returns
+ * the new end.
+ *
+ * There has to be room for max_escape_size * (end - begin) characters
+ * at begin.
+ */
+inline char *escape_in_place(char *begin, char *end) noexcept {
+    size_t extra = 0;
+    for (char const *p = begin; p != end; ++p) {
+        extra += escaped_size(*p) - 1;
+    }
+    if (extra == 0) {
+        return end;
+    }
+    // expands from the back, so nothing is overwritten before it is read
+    char *out = end + extra;
+    for (char *p = end; p != begin;) {
+        char const c = *--p;
+        out -= escaped_size(c);
+        escape_char(out, c);
+    }
+    return end + extra;
+}
+
+// numbers, bools and enums, their placed characters never need escaping
+// unless the fill character of the spec does
+template <typename spec_t, typename type_t>
+constexpr bool is_plain() noexcept {
+    return (placement::internal::is_spec_number<type_t>() ||
+            std::is_same<type_t, bool>::value ||
+            std::is_enum<type_t>::value) &&
+           !needs_escape(spec_t::value.fill);
+}
+
+// values placed unquoted as a field: JSON numbers and bools with the
+// default spec, logfmt numbers and bools without padding
+template <style s, typename spec_t, typename type_t>
+constexpr bool is_raw_field() noexcept {
+    if constexpr (s == style::json) {
+        return spec_t::value.is_default() && is_plain<spec_t, type_t>();
+    } else {
+        return spec_t::value.width == 0 && is_plain<spec_t, type_t>();
+    }
+}
+
+template <typename type_t>
+constexpr bool is_float() noexcept {
+    return placement::internal::is_spec_float<type_t>() ||
+           std::is_same<type_t, placement::shortest_float<float>>::value ||
+           std::is_same<type_t, placement::shortest_float<double>>::value;
+}
+
+// nan and inf are no JSON numbers
+template <typename type_t>
+inline bool is_finite(type_t const &value) noexcept {
+    if constexpr (placement::internal::is_spec_float<type_t>()) {
+        return std::isfinite(value);
+    } else if constexpr (is_float<type_t>()) {
+        return std::isfinite(value.value);
+    } else {
+        return true;
+    }
+}
+
+// upper bound of the characters of a value with measured characters
+// placed by place_escaped
+template <typename spec_t, typename type_t>
+constexpr size_t escaped_size_bound(size_t measured) noexcept {
+    return is_plain<spec_t, type_t>() ? measured
+                                      : max_escape_size * measured;
+}
+
+// places the value escaped as part of a string
+template <typename spec_t, typename type_t>
+inline char *place_escaped(char *out, type_t const &value) noexcept {
+    if constexpr (is_plain<spec_t, type_t>()) {
+        return placement::internal::place_spec<spec_t>(out, value);
+    } else if constexpr (spec_t::value.is_default() &&
+                         (std::is_same<type_t, std::string>::value ||
+                          std::is_same<type_t, std::string_view>::value)) {
+        return escape(out, value.data(), value.size());
+    } else if constexpr (spec_t::value.is_default() &&
+                         std::is_same<type_t, char>::value) {
+        return escape_char(out, value);
+    } else {
+        char *end = placement::internal::place_spec<spec_t>(out, value);
+        return escape_in_place(out, end);
+    }
+}
+
+// upper bound of the characters of a value with measured characters
+// placed by place_field. JSON floats are quoted if they are not finite.
+template <style s, typename spec_t, typename type_t>
+constexpr size_t field_size_bound(size_t measured) noexcept {
+    if constexpr (is_raw_field<s, spec_t, type_t>()) {
+        return measured + (s == style::json && is_float<type_t>() ? 2 : 0);
+    } else {
+        return escaped_size_bound<spec_t, type_t>(measured) + 2;
+    }
+}
+
+// places the value of a named field, a raw number or bool or a quoted
+// string
+template <style s, typename spec_t, typename type_t>
+inline char *place_field(char *out, type_t const &value) noexcept {
+    if constexpr (is_raw_field<s, spec_t, type_t>()) {
+        if (s == style::logfmt || !is_float<type_t>() || is_finite(value)) {
+            return placement::internal::place_spec<spec_t>(out, value);
+        }
+    }
+    *out++ = '"';
+    out = place_escaped<spec_t>(out, value);
+    *out++ = '"';
+    return out;
+}
+
+// characters known at compile time, stored without a trailing zero
+template <size_t size>
+struct literal_buffer {
+    char data[size > 0 ? size : 1] = {};
+};
+
+template <size_t size>
+constexpr literal_buffer<size> escape_literal(std::string_view s) noexcept {
+    literal_buffer<size> result;
+    char *out = result.data;
+    for (char c : s) {
+        out = escape_char(out, c);
+    }
+    return result;
+}
+
+// the literal element [start, start + size) of the literal pool of a
+// format string, escaped at compile time
+template <typename parse_result_t, size_t start, size_t size>
+struct escaped_literal {
+    static constexpr std::string_view source =
+        parse_result_t::literals().substr(start, size);
+    static constexpr size_t escaped_size = internal::escaped_size(source);
+    static constexpr auto value = escape_literal<escaped_size>(source);
+};
+
+// the characters before the message, after it and at the end of the
+// output
+template <style s>
+struct frame;
+
+template <>
+struct frame<style::json> {
+    static constexpr std::string_view open = "{\"msg\":\"";
+    static constexpr std::string_view close_msg = "\"";
+    static constexpr std::string_view close = "}";
+};
+
+template <>
+struct frame<style::logfmt> {
+    static constexpr std::string_view open = "msg=\"";
+    static constexpr std::string_view close_msg = "\"";
+    static constexpr std::string_view close = "";
+};
+
+template <style s, size_t size>
+constexpr literal_buffer<size> make_key(std::string_view name) noexcept {
+    literal_buffer<size> result;
+    char *out = result.data;
+    if (s == style::json) {
+        *out++ = ',';
+        *out++ = '"';
+    } else {
+        *out++ = ' ';
+    }
+    for (char c : name) {
+        *out++ = c;
+    }
+    if (s == style::json) {
+        *out++ = '"';
+        *out++ = ':';
+    } else {
+        *out++ = '=';
+    }
+    return result;
+}
+
+// the characters before the value of a named parameter, e.g.
+// ,"page_id": or  page_id=
+template <style s, typename parse_result_t, typename parameter_t>
+struct field_key {
+    static constexpr std::string_view name =
+        parse_result_t::template name<parameter_t>();
+    static constexpr size_t size =
+        name.size() + (s == style::json ? 4 : 2);
+    static constexpr auto value = make_key<s, size>(name);
+};
+
+}  // namespace internal
+
+}  // namespace structured
+
+}  // namespace pformat
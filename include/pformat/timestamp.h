@@ -0,0 +1,184 @@
+#pragma once
+
+// Placement of wall clock time points as ISO-8601 UTC timestamps with
+// microseconds, e.g. "2024-05-17T08:15:42.123456Z".
+//
+// std::chrono::system_clock::time_point and timespec are placeable once
+// this header is included:
+//
+//     "{} flushed page {}"_fmt.format(std::chrono::system_clock::now(), id);
+//
+// The date and time up to the second is cached per thread. Time points
+// within the same second only place the microseconds, time points within
+// the same minute additionally the seconds.
+
+#include <time.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+#include "integer.h"
+#include "placement.h"
+
+namespace pformat {
+
+namespace placement {
+
+namespace internal {
+
+// "YYYY-MM-DDTHH:MM:SS.uuuuuuZ"
+constexpr size_t timestamp_size = 27;
+// "YYYY-MM-DDTHH:MM:SS."
+constexpr size_t timestamp_prefix_size = 20;
+
+// the range of seconds since the epoch with a four digit year,
+// 0000-01-01T00:00:00 and 9999-12-31T23:59:59
+constexpr int64_t min_timestamp_seconds = -62167219200;
+constexpr int64_t max_timestamp_seconds = 253402300799;
+
+constexpr int64_t floor_div(int64_t a, int64_t b) noexcept {
+    return a / b - (a % b < 0);
+}
+
+struct civil_date {
+    uint32_t year;
+    uint32_t month;
+    uint32_t day;
+};
+
+// the date of a day since 1970-01-01 in the proleptic Gregorian calendar,
+// see Howard Hinnant, "chrono-Compatible Low-Level Date Algorithms"
+constexpr civil_date civil_from_days(int64_t days) noexcept {
+    days += 719468;
+    int64_t const era = floor_div(days, 146097);
+    auto const day_of_era = static_cast<uint32_t>(days - era * 146097);
+    uint32_t const year_of_era =
+        (day_of_era - day_of_era / 1460 + day_of_era / 36524 -
+         day_of_era / 146096) /
+        365;
+    uint32_t const day_of_year =
+        day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+    uint32_t const mp = (5 * day_of_year + 2) / 153;
+    uint32_t const day = day_of_year - (153 * mp + 2) / 5 + 1;
+    uint32_t const month = mp < 10 ? mp + 3 : mp - 9;
+    auto const year =
+        static_cast<uint32_t>(year_of_era + era * 400 + (month <= 2));
+    return {year, month, day};
+}
+
+static_assert(civil_from_days(0).year == 1970);
+static_assert(civil_from_days(-1).day == 31);
+static_assert(civil_from_days(19860).month == 5);  // 2024-05-17
+static_assert(civil_from_days(19860).day == 17);
+
+inline void place_digits2(char *buf, uint32_t value) noexcept {
+    std::memcpy(buf, digits2 + value * 2, 2);
+}
+
+// places "YYYY-MM-DDTHH:MM:SS." of the seconds since the epoch
+inline void place_timestamp_prefix(char *buf, int64_t seconds) noexcept {
+    int64_t const days = floor_div(seconds, 86400);
+    auto const second_of_day = static_cast<uint32_t>(seconds - days * 86400);
+    civil_date const date = civil_from_days(days);
+    place_digits2(buf, date.year / 100);
+    place_digits2(buf + 2, date.year % 100);
+    buf[4] = '-';
+    place_digits2(buf + 5, date.month);
+    buf[7] = '-';
+    place_digits2(buf + 8, date.day);
+    buf[10] = 'T';
+    place_digits2(buf + 11, second_of_day / 3600);
+    buf[13] = ':';
+    place_digits2(buf + 14, second_of_day / 60 % 60);
+    buf[16] = ':';
+    place_digits2(buf + 17, second_of_day % 60);
+    buf[19] = '.';
+}
+
+// the prefix of the last placed second of a thread
+struct timestamp_cache {
+    int64_t second = std::numeric_limits<int64_t>::min();
+    int64_t minute = std::numeric_limits<int64_t>::min();
+    char prefix[timestamp_prefix_size];
+};
+
+/**
+ * places seconds since the epoch and microseconds < 10^6 as a timestamp
+ * of exactly timestamp_size characters.
+ *
+ * Seconds without a four digit year are clamped to the first or last
+ * second of the years 0000 to 9999.
+ */
+inline char *place_timestamp(char *buf, int64_t seconds,
+                             uint32_t micros) noexcept {
+    thread_local timestamp_cache cache;
+    if (seconds != cache.second) {
+        if (seconds < min_timestamp_seconds) {
+            seconds = min_timestamp_seconds;
+        } else if (seconds > max_timestamp_seconds) {
+            seconds = max_timestamp_seconds;
+        }
+        int64_t const minute = floor_div(seconds, 60);
+        if (minute == cache.minute) {
+            place_digits2(cache.prefix + 17,
+                          static_cast<uint32_t>(seconds - minute * 60));
+        } else {
+            place_timestamp_prefix(cache.prefix, seconds);
+            cache.minute = minute;
+        }
+        cache.second = seconds;
+    }
+    std::memcpy(buf, cache.prefix, timestamp_prefix_size);
+    place_digits2(buf + 20, micros / 10000);
+    place_digits2(buf + 22, micros / 100 % 100);
+    place_digits2(buf + 24, micros % 100);
+    buf[26] = 'Z';
+    return buf + timestamp_size;
+}
+
+}  // namespace internal
+
+}  // namespace placement
+
+template <>
+struct formatter<std::chrono::system_clock::time_point> {
+    static constexpr size_t max_size = placement::internal::timestamp_size;
+
+    static char *place(
+        char *buf, std::chrono::system_clock::time_point const &v) noexcept {
+        // rounded down, so time points before the epoch stay in their
+        // microsecond
+        int64_t const us =
+            std::chrono::floor<std::chrono::microseconds>(v.time_since_epoch())
+                .count();
+        int64_t const seconds = placement::internal::floor_div(us, 1000000);
+        return placement::internal::place_timestamp(
+            buf, seconds, static_cast<uint32_t>(us - seconds * 1000000));
+    }
+};
+
+template <>
+struct formatter<timespec> {
+    static constexpr size_t max_size = placement::internal::timestamp_size;
+
+    // tv_nsec outside of [0, 10^9) is carried into the seconds
+    static char *place(char *buf, timespec const &v) noexcept {
+        using namespace placement::internal;
+        int64_t const carry = floor_div(v.tv_nsec, 1000000000);
+        int64_t seconds = v.tv_sec;
+        // seconds outside of the range are clamped anyway, adding the carry
+        // to them could overflow
+        if (seconds >= min_timestamp_seconds &&
+            seconds <= max_timestamp_seconds) {
+            seconds += carry;
+        }
+        return place_timestamp(
+            buf, seconds,
+            static_cast<uint32_t>((v.tv_nsec - carry * 1000000000) / 1000));
+    }
+};
+
+}  // namespace pformat
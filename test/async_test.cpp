@@ -0,0 +1,219 @@
+#include <gtest/gtest.h>
+#include <pformat/async.h>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+// collects all blocks written by an async_writer
+struct string_sink {
+    std::mutex mutex;
+    std::string output;
+    size_t calls = 0;
+
+    pformat::async_writer::sink_t sink() {
+        return [this](char const *data, size_t size) {
+            std::lock_guard<std::mutex> lock(mutex);
+            output.append(data, size);
+            calls++;
+        };
+    }
+};
+}  // namespace
+
+TEST(Async, WriteAndFlush) {
+    using namespace pformat;
+
+    string_sink out;
+    async_writer writer(out.sink());
+    ASSERT_TRUE(writer.write("foo {} bar {}"_fmt, 1, "x"));
+    std::string str{"str"};
+    ASSERT_TRUE(writer.write("{} {} {}"_fmt, str, 1.5, true));
+    writer.flush();
+    {
+        std::lock_guard<std::mutex> lock(out.mutex);
+        ASSERT_EQ(out.output, "foo 1 bar x\nstr 1.500000 true\n");
+        // both messages are written with a single sink call
+        ASSERT_EQ(out.calls, 1U);
+    }
+
+    auto stats = writer.stats();
+    ASSERT_EQ(stats.pushed, 2U);
+    ASSERT_EQ(stats.written, 2U);
+    ASSERT_EQ(stats.dropped, 0U);
+}
+
+TEST(Async, DestructorDrains) {
+    using namespace pformat;
+
+    string_sink out;
+    {
+        async_writer writer(out.sink());
+        for (int i = 0; i < 1000; ++i) {
+            writer.write("{}"_fmt, i);
+        }
+    }
+    std::string expected;
+    for (int i = 0; i < 1000; ++i) {
+        expected += std::to_string(i) + "\n";
+    }
+    ASSERT_EQ(out.output, expected);
+}
+
+TEST(Async, MultipleProducers) {
+    using namespace pformat;
+
+    constexpr int threads = 4;
+    constexpr int messages = 10000;
+    string_sink out;
+    async_options options;
+    options.queue_size = 64;
+    {
+        async_writer writer(out.sink(), options);
+        std::vector<std::thread> producers;
+        for (int t = 0; t < threads; ++t) {
+            producers.emplace_back([&writer, t]() {
+                for (int i = 0; i < messages; ++i) {
+                    writer.write("{} {}"_fmt, t, i);
+                }
+            });
+        }
+        for (auto &p : producers) {
+            p.join();
+        }
+        writer.flush();
+        ASSERT_EQ(writer.stats().written, uint64_t{threads * messages});
+    }
+
+    // messages of each producer stay in order
+    std::vector<int> next(threads);
+    size_t begin = 0;
+    while (begin < out.output.size()) {
+        auto end = out.output.find('\n', begin);
+        auto line = out.output.substr(begin, end - begin);
+        auto space = line.find(' ');
+        int t = std::stoi(line.substr(0, space));
+        int i = std::stoi(line.substr(space + 1));
+        ASSERT_EQ(i, next[t]);
+        next[t]++;
+        begin = end + 1;
+    }
+    for (int t = 0; t < threads; ++t) {
+        ASSERT_EQ(next[t], messages);
+    }
+}
+
+TEST(Async, FlushWithConcurrentProducers) {
+    using namespace pformat;
+
+    string_sink out;
+    async_options options;
+    options.queue_size = 64;
+    // only flush() writes blocks, a stalled flush would not return
+    options.flush_interval = std::chrono::hours(1);
+    async_writer writer(out.sink(), options);
+    std::atomic<bool> done{false};
+    std::vector<std::thread> producers;
+    for (int t = 0; t < 4; ++t) {
+        // long messages keep slots claimed but not committed for longer
+        producers.emplace_back([&writer, &done, t]() {
+            std::string const text(200, 'a' + t);
+            for (int i = 0; !done.load(std::memory_order_relaxed); ++i) {
+                writer.write("{} {} {}"_fmt, t, i, text);
+            }
+        });
+    }
+    for (int i = 0; i < 1000; ++i) {
+        size_t begin;
+        {
+            std::lock_guard<std::mutex> lock(out.mutex);
+            begin = out.output.size();
+        }
+        ASSERT_TRUE(writer.write("marker {}"_fmt, i));
+        writer.flush();
+        std::lock_guard<std::mutex> lock(out.mutex);
+        ASSERT_NE(out.output.find("marker " + std::to_string(i) + "\n", begin),
+                  std::string::npos);
+    }
+    done.store(true);
+    for (auto &p : producers) {
+        p.join();
+    }
+}
+
+TEST(Async, DropAndOverwrite) {
+    using namespace pformat;
+
+    for (auto policy : {backpressure::DROP, backpressure::OVERWRITE}) {
+        // a sink blocking until released keeps the queue full
+        std::mutex block_sink;
+        std::atomic<bool> sink_entered{false};
+        std::string output;
+        auto sink = [&](char const *data, size_t size) {
+            sink_entered = true;
+            std::lock_guard<std::mutex> lock(block_sink);
+            output.append(data, size);
+        };
+
+        async_options options;
+        options.queue_size = 4;
+        options.policy = policy;
+        options.flush_interval = std::chrono::milliseconds(0);
+        block_sink.lock();
+        {
+            async_writer writer(sink, options);
+            writer.write("first"_fmt);
+            while (!sink_entered) {
+                std::this_thread::yield();
+            }
+            for (int i = 0; i < 10; ++i) {
+                writer.write("{}"_fmt, i);
+            }
+            auto stats = writer.stats();
+            if (policy == backpressure::DROP) {
+                EXPECT_EQ(stats.dropped, 6U);
+                EXPECT_EQ(stats.overwritten, 0U);
+            } else {
+                EXPECT_EQ(stats.dropped, 0U);
+                EXPECT_EQ(stats.overwritten, 6U);
+            }
+            block_sink.unlock();
+        }
+        if (policy == backpressure::DROP) {
+            ASSERT_EQ(output, "first\n0\n1\n2\n3\n");
+        } else {
+            ASSERT_EQ(output, "first\n6\n7\n8\n9\n");
+        }
+    }
+}
+
+TEST(Async, LargeRecord) {
+    using namespace pformat;
+
+    string_sink out;
+    std::string const large(1024, 'x');
+    std::string const huge(1 << 17, 'y');
+    {
+        async_options options;
+        options.queue_size = 2;
+        async_writer writer(out.sink(), options);
+        // larger than a queue slot and, for huge, than an output block
+        for (int i = 0; i < 8; ++i) {
+            ASSERT_TRUE(writer.write("{} {}"_fmt, i, large));
+        }
+        ASSERT_TRUE(writer.write("{}"_fmt, huge));
+        ASSERT_TRUE(writer.write("small"_fmt));
+        writer.flush();
+        EXPECT_EQ(writer.stats().dropped, 0U);
+        EXPECT_EQ(writer.stats().written, 10U);
+    }
+    std::string expected;
+    for (int i = 0; i < 8; ++i) {
+        expected += std::to_string(i) + " " + large + "\n";
+    }
+    expected += huge + "\nsmall\n";
+    ASSERT_EQ(out.output, expected);
+}
@@ -0,0 +1,191 @@
+#include <gtest/gtest.h>
+#include <pformat/binary_log.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+using namespace pformat;
+
+namespace {
+// decodes a complete binary log
+bool decode(std::string const &log, std::string &text) {
+    if (log.compare(0, sizeof(binary::file_magic),
+                    std::string(binary::file_magic,
+                                sizeof(binary::file_magic))) != 0) {
+        return false;
+    }
+    binary::decoder decoder;
+    size_t offset = sizeof(binary::file_magic);
+    while (offset < log.size()) {
+        binary::block_header header;
+        std::memcpy(&header, log.data() + offset, sizeof(header));
+        offset += sizeof(header);
+        if (header.magic != binary::block_magic) {
+            return false;
+        }
+        bool const ok =
+            header.type == binary::block_type::DICTIONARY
+                ? decoder.add_dictionary(log.data() + offset, header.size)
+                : decoder.render_block(log.data() + offset, header.size, text);
+        if (!ok) {
+            return false;
+        }
+        offset += header.size;
+    }
+    return true;
+}
+}  // namespace
+
+TEST(BinaryLog, RoundTrip) {
+    constexpr auto f1 = "{} + {} = {}"_fmt;
+    constexpr auto f2 = "name={} value={} ok={}"_fmt;
+    constexpr auto f3 = "{}|{}"_fmt;
+    constexpr auto f4 = "{:08x} {:>6} {:.2f} {:^7}|{:*<4}"_fmt;
+
+    std::string log;
+    std::string expected;
+    {
+        // small blocks to write multiple RECORDS blocks
+        binary::log_writer writer(
+            [&](char const *data, size_t size) { log.append(data, size); },
+            256);
+        for (int i = 0; i < 100; ++i) {
+            writer.write(f1, i, -i * 1000, 0.5 * i);
+            expected += f1.format(i, -i * 1000, 0.5 * i) + "\n";
+            std::string const name = "item" + std::to_string(i);
+            writer.write(f2, name, uint64_t(i) << 40, i % 2 == 0);
+            expected += f2.format(name, uint64_t(i) << 40, i % 2 == 0) + "\n";
+            writer.write(f4, uint32_t(i * 7919), name, i / 3.0, -i, 'c');
+            expected += f4.format(uint32_t(i * 7919), name, i / 3.0, -i, 'c') +
+                        "\n";
+        }
+        writer.flush();
+        // sites used after the first dictionary are described later
+        writer.write(f3, shortest(0.1f), 'x');
+        expected += f3.format(shortest(0.1f), 'x') + "\n";
+    }
+
+    std::string text;
+    ASSERT_TRUE(decode(log, text));
+    EXPECT_EQ(expected, text);
+}
+
+TEST(BinaryLog, UnknownSite) {
+    constexpr auto f = "value {}"_fmt;
+    std::string log;
+    {
+        binary::log_writer writer(
+            [&](char const *data, size_t size) { log.append(data, size); });
+        writer.write(f, 42);
+    }
+    binary::decoder decoder;
+    size_t offset = sizeof(binary::file_magic);
+    binary::block_header header;
+    do {
+        std::memcpy(&header, log.data() + offset, sizeof(header));
+        offset += sizeof(header) + header.size;
+    } while (header.type != binary::block_type::RECORDS);
+    offset -= header.size;
+
+    // the records can not be rendered without the dictionary
+    std::string text;
+    EXPECT_FALSE(decoder.render_block(log.data() + offset, header.size, text));
+    // a truncated block is detected
+    EXPECT_FALSE(decoder.render_block(log.data() + offset, header.size - 1,
+                                      text));
+}
+
+TEST(BinaryLog, RejectsInvalidPrecision) {
+    constexpr auto f = "{:.19f}"_fmt;
+    std::string dictionary;
+    binary::internal::append_u32(dictionary, 1);
+    binary::internal::append_site(dictionary, f.get_site<double>());
+
+    // the precision of the only segment ends the dictionary
+    int32_t precision;
+    size_t const precision_offset = dictionary.size() - sizeof(precision);
+    std::memcpy(&precision, dictionary.data() + precision_offset,
+                sizeof(precision));
+    ASSERT_EQ(precision, 19);
+    ASSERT_TRUE(binary::decoder().add_dictionary(dictionary.data(),
+                                                 dictionary.size()));
+
+    precision = 20;
+    std::memcpy(dictionary.data() + precision_offset, &precision,
+                sizeof(precision));
+    EXPECT_FALSE(binary::decoder().add_dictionary(dictionary.data(),
+                                                  dictionary.size()));
+}
+
+TEST(BinaryLog, RejectsCollidingSites) {
+    constexpr auto f = "colliding {}"_fmt;
+    binary::site const &site = f.get_site<int>();
+    binary::site other = site;
+    other.format = "colliding {} site";
+    // without parameters, so its argument types are empty
+    binary::site const &empty = "no parameters"_fmt.get_site<>();
+
+    std::string dictionary;
+    binary::internal::append_u32(dictionary, 3);
+    binary::internal::append_site(dictionary, site);
+    binary::internal::append_site(dictionary, empty);
+    // the same site may be described again
+    binary::internal::append_site(dictionary, site);
+    binary::decoder decoder;
+    ASSERT_TRUE(decoder.add_dictionary(dictionary.data(), dictionary.size()));
+
+    dictionary.clear();
+    binary::internal::append_u32(dictionary, 1);
+    binary::internal::append_site(dictionary, other);
+    EXPECT_FALSE(decoder.add_dictionary(dictionary.data(), dictionary.size()));
+}
+
+#ifdef PFORMAT_DECODE
+// the pformat_decode tool renders a log file exactly like format()
+TEST(BinaryLog, DecodeTool) {
+    constexpr auto f1 = "{} + {} = {}"_fmt;
+    constexpr auto f2 = "{:08x} {:>6} {:.3f} {:^7}|{:*<4}"_fmt;
+    constexpr auto f3 = "no parameters"_fmt;
+
+    std::string const log_path = ::testing::TempDir() + "pformat_decode.log";
+    std::string const text_path = ::testing::TempDir() + "pformat_decode.txt";
+    std::string expected;
+    FILE *file = std::fopen(log_path.c_str(), "wb");
+    ASSERT_NE(file, nullptr);
+    {
+        // small blocks, so the tool decodes many blocks in parallel
+        binary::log_writer writer(
+            [file](char const *data, size_t size) {
+                std::fwrite(data, 1, size, file);
+            },
+            4096);
+        for (int i = 0; i < 10000; ++i) {
+            writer.write(f1, i, -i * 1000, 0.1 * i);
+            expected += f1.format(i, -i * 1000, 0.1 * i) + "\n";
+            std::string const name = "item" + std::to_string(i);
+            writer.write(f2, uint32_t(i * 7919), name, i / 7.0, -i, 'c');
+            expected += f2.format(uint32_t(i * 7919), name, i / 7.0, -i, 'c') +
+                        "\n";
+            if (i % 100 == 0) {
+                writer.write(f3);
+                expected += f3.format() + "\n";
+            }
+        }
+    }
+    ASSERT_EQ(std::fclose(file), 0);
+
+    std::string const command = std::string(PFORMAT_DECODE) + " -j 4 " +
+                                log_path + " " + text_path;
+    ASSERT_EQ(std::system(command.c_str()), 0);
+    std::ifstream text_file(text_path, std::ios::binary);
+    std::stringstream text;
+    text << text_file.rdbuf();
+    EXPECT_EQ(expected, text.str());
+    std::remove(log_path.c_str());
+    std::remove(text_path.c_str());
+}
+#endif
@@ -0,0 +1,93 @@
+#include <gtest/gtest.h>
+#include <pformat/export.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace {
+using row_t = std::tuple<uint64_t, int, std::string, double>;
+
+std::vector<row_t> make_rows(size_t count) {
+    std::vector<row_t> rows;
+    for (size_t i = 0; i < count; ++i) {
+        rows.emplace_back(i * 1000003, -static_cast<int>(i % 777),
+                          std::string(i % 13, 'x'), i / 4.0);
+    }
+    return rows;
+}
+
+// exports the rows into a temporary file and returns its content
+template <typename log_config_t>
+std::string export_to_string(log_config_t const &format,
+                             std::vector<row_t> const &rows,
+                             pformat::export_options const &options,
+                             pformat::export_result &result) {
+    std::FILE *file = std::tmpfile();
+    int const fd = fileno(file);
+    result = pformat::export_rows(fd, format, rows, options);
+    std::string content(::lseek(fd, 0, SEEK_END), '\0');
+    ::pread(fd, content.data(), content.size(), 0);
+    std::fclose(file);
+    return content;
+}
+}  // namespace
+
+TEST(Export, RowsInOrder) {
+    using namespace pformat;
+
+    constexpr auto csv = "{},{},{},{:.2f}\n"_fmt;
+    auto const rows = make_rows(10000);
+    std::string expected;
+    for (auto const &row : rows) {
+        std::apply([&](auto const &... args) {
+            csv.format_append(expected, args...);
+        }, row);
+    }
+
+    for (unsigned threads : {1, 2, 4}) {
+        for (size_t chunk_rows : {1, 7, 1000, 20000}) {
+            export_options options;
+            options.threads = threads;
+            options.chunk_rows = chunk_rows;
+            options.window = 3;
+            export_result result;
+            auto const output =
+                export_to_string(csv, rows, options, result);
+            ASSERT_EQ(output, expected) << threads << " " << chunk_rows;
+            ASSERT_EQ(result.error, 0);
+            ASSERT_EQ(result.rows, rows.size());
+            ASSERT_EQ(result.bytes, expected.size());
+        }
+    }
+}
+
+TEST(Export, Empty) {
+    using namespace pformat;
+
+    export_options options;
+    options.threads = 4;
+    export_result result;
+    ASSERT_EQ(export_to_string("{}\t{}\t{}\t{}\n"_fmt, {}, options, result),
+              "");
+    ASSERT_EQ(result.rows, 0U);
+    ASSERT_EQ(result.error, 0);
+}
+
+TEST(Export, WriteError) {
+    using namespace pformat;
+
+    auto const rows = make_rows(100);
+    for (unsigned threads : {1, 4}) {
+        export_options options;
+        options.threads = threads;
+        options.chunk_rows = 10;
+        auto result = export_rows(-1, "{},{},{},{}\n"_fmt, rows, options);
+        ASSERT_EQ(result.error, EBADF);
+        ASSERT_EQ(result.rows, 0U);
+        ASSERT_EQ(result.bytes, 0U);
+    }
+}
@@ -1,7 +1,22 @@
 #include <gtest/gtest.h>
 #include <pformat/pformat.h>
+#include <pformat/timestamp.h>
 
+#include <unistd.h>
+
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
 #include <numeric>
+#include <random>
+#include <set>
+
+namespace {
+enum some_enum { SOME_ENUM_A, SOME_ENUM_B };
+
+struct some_class {};
+
+}  // namespace
 
 TEST(PFormat, Format) {
     using namespace pformat;
@@ -63,6 +78,26 @@ TEST(Pformat, Escaping) {
     ASSERT_EQ(f6.format(), "foo {} bar");
 }
 
+#define PFORMAT_TEST_X10(s) s s s s s s s s s s
+
+TEST(Pformat, LongFormatString) {
+    using namespace pformat;
+
+    // the parser does not recurse per character, so format strings far
+    // beyond the template instantiation depth are fine
+    constexpr auto f = PFORMAT_TEST_X10(
+        PFORMAT_TEST_X10("0123456789") PFORMAT_TEST_X10(" {}")) "{{}}"_fmt;
+    static_assert(f.ok());
+    auto s = f.format(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9,
+                      0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9,
+                      0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9,
+                      0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9,
+                      0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9);
+    ASSERT_EQ(s.size(), 10 * (100 + 20) + 2);
+    ASSERT_EQ(s.substr(100, 24), " 0 1 2 3 4 5 6 7 8 90123");
+    ASSERT_EQ(s.substr(s.size() - 4), " 9{}");
+}
+
 TEST(Pformat, FormatInteger) {
     using namespace pformat;
 
@@ -74,6 +109,43 @@ TEST(Pformat, FormatInteger) {
     ASSERT_EQ(s, "foo 18446744073709551615 bar -17 do -9223372036854775808");
 }
 
+TEST(Pformat, FormatIntegerWidths) {
+    using namespace pformat;
+
+    constexpr auto f = "{} {} {} {}"_fmt;
+    ASSERT_EQ(f.format(std::numeric_limits<int8_t>::min(),
+                       std::numeric_limits<int16_t>::min(),
+                       std::numeric_limits<int32_t>::min(),
+                       std::numeric_limits<int64_t>::max()),
+              "-128 -32768 -2147483648 9223372036854775807");
+    ASSERT_EQ(f.format(std::numeric_limits<uint8_t>::max(),
+                       std::numeric_limits<uint16_t>::max(),
+                       std::numeric_limits<uint32_t>::max(), uint64_t{0}),
+              "255 65535 4294967295 0");
+}
+
+TEST(Pformat, FormatIntegerDigitBoundaries) {
+    using namespace pformat;
+
+    constexpr auto f = "{}"_fmt;
+    char compare_buf[30];
+    // every power of ten and its neighbours hits a digit count boundary
+    for (uint64_t p = 1; p <= 10000000000000000000ULL; p *= 10) {
+        for (uint64_t v : {p - 1, p, p + 1}) {
+            std::snprintf(compare_buf, 30, "%llu",
+                          static_cast<unsigned long long>(v));
+            ASSERT_EQ(f.format(v), compare_buf);
+            auto neg = -static_cast<int64_t>(v / 2);
+            std::snprintf(compare_buf, 30, "%lld",
+                          static_cast<long long>(neg));
+            ASSERT_EQ(f.format(neg), compare_buf);
+        }
+        if (p == 10000000000000000000ULL) {
+            break;
+        }
+    }
+}
+
 TEST(Pformat, FormatDouble) {
     using namespace pformat;
 
@@ -85,6 +157,178 @@ TEST(Pformat, FormatDouble) {
     ASSERT_EQ(s, "foo 0.000000 bar inf do nan");
 }
 
+TEST(Pformat, FormatDoubleMatchesPrintf) {
+    using namespace pformat;
+
+    constexpr auto f = "{}"_fmt;
+    std::vector<double> values{
+        -0.0,    0.5,     1.5,     2.5,    0.0078125,
+        1e-7,    5e-7,    1e-300,  1e15,   123456.7890125,
+        1e300,   -1e300,  4.9e-324, std::numeric_limits<double>::max(),
+        -std::numeric_limits<double>::infinity(),
+        -std::numeric_limits<double>::quiet_NaN()};
+    std::mt19937_64 rnd(42);
+    for (int i = 0; i < 10000; ++i) {
+        uint64_t bits = rnd();
+        double v;
+        std::memcpy(&v, &bits, sizeof(v));
+        values.push_back(v);
+        values.push_back(std::ldexp(static_cast<double>(rnd() >> 11),
+                                    static_cast<int>(rnd() % 120) - 100));
+    }
+
+    char compare_buf[400];
+    for (double v : values) {
+        std::snprintf(compare_buf, sizeof(compare_buf), "%f", v);
+        ASSERT_EQ(f.format(v), compare_buf);
+        ASSERT_LE(std::strlen(compare_buf) + 1, f.string_size_bound(v));
+    }
+}
+
+TEST(Pformat, FormatFloat) {
+    using namespace pformat;
+
+    constexpr auto f = "{} {}"_fmt;
+    ASSERT_EQ(f.format(0.1f, std::numeric_limits<float>::max()),
+              "0.100000 340282346638528859811704183484516925440.000000");
+    ASSERT_EQ(f.string_size_bound(0.1f, 0.1f), 2 * 47U + 2);
+}
+
+TEST(Pformat, FormatLongDouble) {
+    using namespace pformat;
+
+    // placed as double
+    constexpr auto f = "{} {:>10}"_fmt;
+    ASSERT_EQ(f.format(1.5L, -0.25L), "1.500000  -0.250000");
+    ASSERT_EQ(f.format(1e300L, 0.0L), f.format(1e300, 0.0));
+    ASSERT_EQ(f.string_size_bound(1.5L, 1.5L), f.string_size_bound(1.5, 1.5));
+    ASSERT_EQ("{}"_fmt.format(std::vector<long double>{0.5L, 2}),
+              "[0.500000, 2.000000]");
+    ASSERT_EQ((f.get_site<long double, long double>().arg_types[0]),
+              binary::arg_type::DOUBLE);
+    ASSERT_EQ(render(f.capture(1.5L, -0.25L).data()), "1.500000  -0.250000");
+}
+
+TEST(Pformat, FormatShortest) {
+    using namespace pformat;
+
+    constexpr auto f = "{}"_fmt;
+    ASSERT_EQ(f.format(shortest(0.1)), "0.1");
+    ASSERT_EQ(f.format(shortest(0.1f)), "0.1");
+    ASSERT_EQ(f.format(shortest(1.0)), "1.0");
+    ASSERT_EQ(f.format(shortest(-0.0)), "-0.0");
+    ASSERT_EQ(f.format(shortest(1234.5)), "1234.5");
+    ASSERT_EQ(f.format(shortest(0.00125)), "0.00125");
+    ASSERT_EQ(f.format(shortest(1.5e-7)), "1.5e-07");
+    ASSERT_EQ(f.format(shortest(1e300)), "1e+300");
+    ASSERT_EQ(f.format(shortest(1e17)), "1e+17");
+    ASSERT_EQ(f.format(shortest(1e16)), "10000000000000000.0");
+    ASSERT_EQ(f.format(shortest(std::numeric_limits<double>::infinity())),
+              "inf");
+
+    std::mt19937_64 rnd(42);
+    for (int i = 0; i < 10000; ++i) {
+        uint64_t bits = rnd();
+        double v;
+        std::memcpy(&v, &bits, sizeof(v));
+        float fv;
+        uint32_t fbits = static_cast<uint32_t>(bits);
+        std::memcpy(&fv, &fbits, sizeof(fv));
+        if (!std::isfinite(v) || !std::isfinite(fv)) {
+            continue;
+        }
+        auto s = f.format(shortest(v));
+        ASSERT_EQ(std::strtod(s.c_str(), nullptr), v) << s;
+        ASSERT_LE(s.size() + 1, f.string_size_bound(shortest(v)));
+        s = f.format(shortest(fv));
+        ASSERT_EQ(std::strtof(s.c_str(), nullptr), fv) << s;
+        ASSERT_LE(s.size() + 1, f.string_size_bound(shortest(fv)));
+    }
+}
+
+TEST(Pformat, FormatSpecs) {
+    using namespace pformat;
+
+    ASSERT_EQ("{:x} {:X}"_fmt.format(255, 0xabcdefU), "ff ABCDEF");
+    ASSERT_EQ("{:08x}"_fmt.format(0xbeefU), "0000beef");
+    ASSERT_EQ("{:x} {:08x}"_fmt.format(-255, int64_t(-255)), "-ff -00000ff");
+    ASSERT_EQ("{:x}"_fmt.format(std::numeric_limits<uint64_t>::max()),
+              "ffffffffffffffff");
+    ASSERT_EQ("{:x}"_fmt.format(std::numeric_limits<int8_t>::min()), "-80");
+    ASSERT_EQ("{:d}|{:5}|{:<5}|{:3}"_fmt.format(5, 42, 42, 12345),
+              "5|   42|42   |12345");
+    ASSERT_EQ("{:>10}|{:5}|{:^7}|{:*^6}"_fmt.format("abc", "ab", "abc", 'x'),
+              "       abc|ab   |  abc  |**x***");
+    ASSERT_EQ("{:0>4}"_fmt.format(7), "0007");
+    ASSERT_EQ("{:05}"_fmt.format(-42), "-0042");
+    ASSERT_EQ("{:<05}"_fmt.format(-42), "-42  ");
+    ASSERT_EQ("{:.3f} {:.0f} {:f}"_fmt.format(3.14159, 2.5, 0.1f),
+              "3.142 2 0.100000");
+    ASSERT_EQ("{:10.2f}|{:08.3f}"_fmt.format(3.14159, -3.14159),
+              "      3.14|-003.142");
+    ASSERT_EQ("{:08}"_fmt.format(std::numeric_limits<double>::quiet_NaN()),
+              "     nan");
+    ASSERT_EQ("{:8}|{:6}"_fmt.format(shortest(0.5), true), "     0.5|true  ");
+    ASSERT_EQ("{:x} {:>3}"_fmt.format(SOME_ENUM_B, SOME_ENUM_B), "1   1");
+    ASSERT_EQ("{:}"_fmt.format(17), "17");
+}
+
+TEST(Pformat, FormatSpecsMatchPrintf) {
+    using namespace pformat;
+
+    constexpr auto f = "{:x}|{:08X}|{:12}|{:.3f}|{:14.8f}"_fmt;
+    std::mt19937_64 rnd(42);
+    char compare_buf[800];
+    for (int i = 0; i < 10000; ++i) {
+        auto const u = static_cast<uint32_t>(rnd() >> (rnd() % 32));
+        auto const d = static_cast<int64_t>(rnd()) >> (rnd() % 64);
+        double const v = std::ldexp(static_cast<double>(rnd() >> 11),
+                                    static_cast<int>(rnd() % 80) - 70);
+        std::snprintf(compare_buf, sizeof(compare_buf),
+                      "%x|%08X|%12lld|%.3f|%14.8f", u, u,
+                      static_cast<long long>(d), v, -v);
+        ASSERT_EQ(f.format(u, u, d, v, -v), compare_buf);
+        ASSERT_LE(std::strlen(compare_buf) + 1,
+                  f.string_size_bound(u, u, d, v, -v));
+    }
+}
+
+TEST(Pformat, FormatSpecsMaxPrecision) {
+    using namespace pformat;
+
+    // 19 digits is the largest precision, {:.20f} does not compile
+    constexpr auto f = "{:.19f}"_fmt;
+    std::mt19937_64 rnd(19);
+    char compare_buf[400];
+    for (double v : {0.1, 1.0 / 3, 123456.789, 1e-19, 5e-20, 0.0}) {
+        std::snprintf(compare_buf, sizeof(compare_buf), "%.19f", v);
+        ASSERT_EQ(f.format(v), compare_buf);
+    }
+    for (int i = 0; i < 10000; ++i) {
+        double const v = std::ldexp(static_cast<double>(rnd() >> 11),
+                                    static_cast<int>(rnd() % 80) - 70);
+        std::snprintf(compare_buf, sizeof(compare_buf), "%.19f", v);
+        ASSERT_EQ(f.format(v), compare_buf);
+        ASSERT_LE(std::strlen(compare_buf) + 1, f.string_size_bound(v));
+    }
+}
+
+TEST(Pformat, FormatSpecsSizeBound) {
+    using namespace pformat;
+
+    static_assert("{:08x}"_fmt.static_string_size_bound<uint32_t>() == 9);
+    static_assert("{:x}"_fmt.static_string_size_bound<int64_t>() == 18);
+    static_assert("{:20}"_fmt.static_string_size_bound<int8_t>() == 21);
+    static_assert("{:.3f}"_fmt.static_string_size_bound<double>() ==
+                  "{}"_fmt.static_string_size_bound<double>() - 3);
+
+    constexpr auto f = "[{:>6}] {:.2f}"_fmt;
+    auto s = f.format_fixed(uint8_t(200), 0.125);
+    ASSERT_EQ(s.view(), "[   200] 0.12");
+    ASSERT_EQ(f.string_size_bound("abcdefgh", 0.125),
+              3 + 8 + std::numeric_limits<double>::max_exponent10 + 5 + 1);
+}
+
 TEST(Pformat, FormatChar) {
     using namespace pformat;
 
@@ -103,6 +347,75 @@ TEST(Pformat, FormatBool) {
     ASSERT_EQ(s, "foo true bar false");
 }
 
+TEST(Pformat, StaticSizeBound) {
+    using namespace pformat;
+
+    constexpr auto f = "foo {} bar {}"_fmt;
+    static_assert(f.static_string_size_bound<int8_t, bool>() == 9 + 4 + 5 + 1);
+    static_assert(f.static_string_size_bound<uint64_t &, char const &>() ==
+                  9 + 20 + 1 + 1);
+    using underlying_t = std::underlying_type<some_enum>::type;
+    static_assert(f.static_string_size_bound<some_enum, unsigned char>() ==
+                  f.static_string_size_bound<underlying_t, uint8_t>());
+}
+
+TEST(Pformat, FormatFixed) {
+    using namespace pformat;
+
+    constexpr auto f = "foo {} bar {} do {}"_fmt;
+    int64_t a = std::numeric_limits<int64_t>::min();
+    auto s = f.format_fixed(a, true, 'x');
+    static_assert(decltype(s)::capacity() == 13 + 20 + 5 + 1 + 1);
+    ASSERT_EQ(s.view(), "foo -9223372036854775808 bar true do x");
+    ASSERT_EQ(std::strlen(s.c_str()), s.size());
+
+    auto s2 = "{} {}"_fmt.format_fixed(1.5, shortest(0.25f));
+    ASSERT_EQ(s2.view(), "1.500000 0.25");
+
+    // copies keep the terminated characters
+    auto const copy = s2;
+    ASSERT_EQ(copy.view(), "1.500000 0.25");
+    ASSERT_EQ(std::strlen(copy.c_str()), copy.size());
+}
+
+namespace {
+enum class constexpr_enum : uint8_t { value = 3 };
+
+constexpr std::string_view constexpr_view = "view";
+}  // namespace
+
+TEST(Pformat, FormatConstexpr) {
+    using namespace pformat;
+
+    constexpr auto s = "{} {}.{} [{:>6}] {:#^7} {:08x} {:X} {}"_fmt
+                           .format_constexpr("pformat", 1, -2, true, 'c',
+                                             -255, 0xabcu,
+                                             constexpr_enum::value);
+    static_assert(s.view() == "pformat 1.-2 [  true] ###c### -00000ff ABC 3");
+    // the literals, the arguments (the string literal with its length)
+    // and the trailing zero
+    static_assert(decltype(s)::capacity() ==
+                  9 + 7 + 11 + 11 + 6 + 7 + 9 + 8 + 3 + 1);
+
+    constexpr auto limits = "{} {} {:x}"_fmt.format_constexpr(
+        std::numeric_limits<int64_t>::min(),
+        std::numeric_limits<uint64_t>::max(), int8_t(-128));
+    static_assert(limits.view() ==
+                  "-9223372036854775808 18446744073709551615 -80");
+
+    // C strings and string_views need a capacity
+    constexpr auto views = "<{}|{:<6}|{:^6}>"_fmt.format_constexpr<32>(
+        constexpr_view, constexpr_view, "ab");
+    static_assert(views.view() == "<view|view  |  ab  >");
+
+    // identical to format at runtime, too long output is truncated
+    int const value = -42;
+    auto s2 = "{:+>8}|{:<5}"_fmt.format_constexpr(value, false);
+    ASSERT_EQ(s2.view(), "{:+>8}|{:<5}"_fmt.format(value, false));
+    auto s3 = "{}"_fmt.format_constexpr<4>(std::string_view("toolong"));
+    ASSERT_EQ(s3.view(), "too");
+}
+
 TEST(Pformat, FormatString) {
     using namespace pformat;
 
@@ -113,6 +426,37 @@ TEST(Pformat, FormatString) {
     ASSERT_EQ(f.format(std::move(str)), "xfooy");
 }
 
+TEST(Pformat, FormatLongString) {
+    using namespace pformat;
+
+    constexpr auto f = "x{}y{}z{}"_fmt;
+    std::string long_str(2000, 'a');
+    auto s = f.format(long_str, long_str.c_str(), 1.5);
+    ASSERT_EQ(s, "x" + long_str + "y" + long_str + "z1.500000");
+    ASSERT_EQ(s.size(), 4011U);
+
+    // the string does not keep the excess of the float bounds
+    auto const floats = "{} {} {}"_fmt.format(1.0, 2.0, 3.0);
+    ASSERT_EQ(floats, "1.000000 2.000000 3.000000");
+    ASSERT_LT(floats.capacity(), 100U);
+}
+
+TEST(Pformat, ExactSize) {
+    using namespace pformat;
+    using placement::exact_size;
+
+    ASSERT_EQ(exact_size(0), 1U);
+    ASSERT_EQ(exact_size(-1), 2U);
+    ASSERT_EQ(exact_size(std::numeric_limits<int8_t>::min()), 4U);
+    ASSERT_EQ(exact_size(std::numeric_limits<int64_t>::min()), 20U);
+    ASSERT_EQ(exact_size(std::numeric_limits<uint64_t>::max()), 20U);
+    ASSERT_EQ(exact_size(uint32_t{999999999}), 9U);
+    ASSERT_EQ(exact_size(uint32_t{1000000000}), 10U);
+    ASSERT_EQ(exact_size(true), 4U);
+    ASSERT_EQ(exact_size(false), 5U);
+    ASSERT_EQ(exact_size(SOME_ENUM_B), 1U);
+}
+
 TEST(Pformat, FormatStringView) {
     using namespace pformat;
 
@@ -122,6 +466,214 @@ TEST(Pformat, FormatStringView) {
     ASSERT_EQ(f.format(sv), "xfooy");
 }
 
+TEST(Pformat, FormatToN) {
+    using namespace pformat;
+
+    constexpr auto f = "id {} name {}!"_fmt;
+    char buf[32];
+    auto r = f.format_to_n(buf, sizeof(buf), 42, "abc");
+    ASSERT_FALSE(r.truncated);
+    ASSERT_EQ(r.size, 15U);
+    ASSERT_EQ(r.out, buf + 15);
+    ASSERT_STREQ(buf, "id 42 name abc!");
+
+    // strings are cut, the rest is left out
+    r = f.format_to_n(buf, 14, 42, "abcdef");
+    ASSERT_TRUE(r.truncated);
+    ASSERT_STREQ(buf, "id 42 name ab");
+    ASSERT_EQ(r.size, 13U);
+
+    // elements are left out completely
+    r = f.format_to_n(buf, 8, 42, "abc");
+    ASSERT_TRUE(r.truncated);
+    ASSERT_STREQ(buf, "id 42");
+
+    // numbers are left out completely
+    r = f.format_to_n(buf, 6, 12345, "abc");
+    ASSERT_TRUE(r.truncated);
+    ASSERT_STREQ(buf, "id ");
+
+    // strings are not cut within a UTF-8 character
+    r = f.format_to_n(buf, 14, 42, "a\xc3\xa4");
+    ASSERT_TRUE(r.truncated);
+    ASSERT_STREQ(buf, "id 42 name a");
+
+    r = f.format_to_n(buf, 0, 42, "abc");
+    ASSERT_TRUE(r.truncated);
+    ASSERT_EQ(r.size, 0U);
+}
+
+TEST(Pformat, FormatToNStaticBound) {
+    using namespace pformat;
+
+    constexpr auto f = "{:>6}|{:.2f}|{}"_fmt;
+    char buf[256];
+    // the static bound of doubles exceeds the buffer
+    static_assert(f.static_string_size_bound<int, double, bool>() >
+                  sizeof(buf));
+    auto r = f.format_to_n(buf, sizeof(buf), 7, 1.5, true);
+    ASSERT_FALSE(r.truncated);
+    ASSERT_STREQ(buf, "     7|1.50|true");
+
+    constexpr auto g = "{:08x} {}"_fmt;
+    // fast path: the static bound fits into the buffer
+    static_assert(g.static_string_size_bound<uint32_t, char>() <= 32);
+    r = g.format_to_n(buf, 32, uint32_t{255}, 'c');
+    ASSERT_FALSE(r.truncated);
+    ASSERT_STREQ(buf, "000000ff c");
+
+    // doubles, whose measured size is only an upper bound, are placed if
+    // the actual output fits
+    r = f.format_to_n(buf, 13, 7, 1.5, true);
+    ASSERT_TRUE(r.truncated);
+    ASSERT_STREQ(buf, "     7|1.50|");
+
+    // the output never exceeds the buffer
+    std::string const expected = f.format(12345, -2.25, false);
+    for (size_t n = 1; n <= expected.size() + 1; ++n) {
+        std::memset(buf, 'X', sizeof(buf));
+        r = f.format_to_n(buf, n, 12345, -2.25, false);
+        ASSERT_LT(r.size, n);
+        ASSERT_EQ(buf[r.size], 0);
+        ASSERT_EQ(buf[n], 'X');
+        ASSERT_EQ(expected.substr(0, r.size), buf);
+        ASSERT_EQ(r.truncated, n <= expected.size());
+    }
+}
+
+TEST(Pformat, FormatAppendMemoryBuffer) {
+    using namespace pformat;
+
+    constexpr auto f = "{} {:>4}|"_fmt;
+    memory_buffer buffer;
+    f.format_append(buffer, "a", 1);
+    f.format_append(buffer, std::string("bc"), 23);
+    ASSERT_EQ(buffer.view(), "a    1|bc   23|");
+    ASSERT_EQ(buffer.capacity(), 500U);
+
+    // grows beyond the inline storage
+    std::string const long_str(1000, 'x');
+    f.format_append(buffer, long_str, 4);
+    ASSERT_EQ(buffer.size(), 15U + 1006U);
+    ASSERT_GE(buffer.capacity(), buffer.size());
+    ASSERT_EQ(buffer.view().substr(0, 15), "a    1|bc   23|");
+    ASSERT_EQ(buffer.view().substr(15), long_str + "    4|");
+
+    memory_buffer moved(std::move(buffer));
+    ASSERT_EQ(moved.size(), 1021U);
+    ASSERT_EQ(buffer.size(), 0U);
+    ASSERT_EQ(buffer.capacity(), 500U);
+
+    memory_buffer small;
+    f.format_append(small, "s", 1);
+    memory_buffer copy(small);
+    moved = std::move(small);
+    ASSERT_EQ(moved.str(), "s    1|");
+    ASSERT_EQ(copy.str(), "s    1|");
+
+    moved.clear();
+    ASSERT_EQ(moved.size(), 0U);
+}
+
+TEST(Pformat, FormatBatch) {
+    using namespace pformat;
+
+    constexpr auto f = "id={} delta={} ratio={:.2f} name={} code={:04x}"_fmt;
+    using record_t = std::tuple<uint64_t, int, double, std::string, unsigned>;
+    std::vector<record_t> records;
+    std::mt19937_64 rnd(42);
+    for (size_t i = 0; i < 200; ++i) {
+        records.emplace_back(rnd() >> (rnd() % 64),
+                             static_cast<int>(rnd()), (rnd() % 1000) / 8.0,
+                             std::string(rnd() % 40, 'n'),
+                             static_cast<unsigned>(rnd() % 0x10000));
+    }
+    records.emplace_back(std::numeric_limits<uint64_t>::max(),
+                         std::numeric_limits<int>::min(), -0.5, "", 0);
+
+    for (size_t count : {0, 1, 63, 64, 65, 201}) {
+        std::string expected = "header;";
+        memory_buffer buffer;
+        buffer.append(expected);
+        for (size_t i = 0; i < count; ++i) {
+            if (i > 0) {
+                expected += ";";
+            }
+            std::apply([&](auto const &... args) {
+                f.format_append(expected, args...);
+            }, records[i]);
+        }
+        f.format_batch(records.data(), count, buffer, ";");
+        ASSERT_EQ(buffer.view(), expected) << count;
+    }
+
+    // the default separator is a newline
+    constexpr auto g = "{}"_fmt;
+    std::vector<std::tuple<char const *>> strings{{"a"}, {"b"}};
+    memory_buffer buffer;
+    g.format_batch(strings, buffer);
+    ASSERT_EQ(buffer.view(), "a\nb");
+}
+
+TEST(Pformat, FormatAppendString) {
+    using namespace pformat;
+
+    constexpr auto f = "{}={};"_fmt;
+    std::string str = "x:";
+    f.format_append(str, "a", 1.5);
+    f.format_append(str, std::string_view("b"), -2);
+    ASSERT_EQ(str, "x:a=1.500000;b=-2;");
+}
+
+TEST(Pformat, FormatIov) {
+    using namespace pformat;
+
+    std::string const body(300, 'b');
+    std::string_view const small = "small";
+    constexpr auto f = "id={} body={} small={} ratio={:.1f}\n"_fmt;
+    iov_builder out(100);
+    f.format_iov(out, 42, body, small, 0.25);
+    ASSERT_EQ(out.str(), f.format(42, body, small, 0.25));
+    // "id=42 body=", the body and the rest
+    ASSERT_EQ(out.size(), 3U);
+    ASSERT_EQ(out.data()[1].iov_base, body.data());
+    ASSERT_EQ(out.bytes(), out.str().size());
+
+    // long literals are referenced, scratch parts of consecutive calls
+    // are merged
+    iov_builder all(1);
+    for (int i = 0; i < 3000; ++i) {
+        "{} "_fmt.format_iov(all, i);
+    }
+    std::string expected;
+    for (int i = 0; i < 3000; ++i) {
+        expected += std::to_string(i) + " ";
+    }
+    ASSERT_EQ(all.str(), expected);
+    ASSERT_EQ(all.size(), 6000U);
+
+    // more segments than a single writev takes
+    std::FILE *file = std::tmpfile();
+    ASSERT_EQ(all.write_to(fileno(file)), 0);
+    ASSERT_EQ(all.size(), 0U);
+    std::string content(expected.size(), '\0');
+    ASSERT_EQ(::pread(fileno(file), content.data(), content.size(), 0),
+              static_cast<ssize_t>(expected.size()));
+    std::fclose(file);
+    ASSERT_EQ(content, expected);
+
+    f.format_iov(out, 1, body, small, 1.0);
+    ASSERT_EQ(out.write_to(-1), EBADF);
+    // the scratch parts around the calls are merged
+    ASSERT_EQ(out.size(), 5U);
+
+    // the scratch memory is reused after clear
+    out.clear();
+    f.format_iov(out, 7, small, small, 2.0);
+    ASSERT_EQ(out.str(), "id=7 body=small small=small ratio=2.0\n");
+    ASSERT_EQ(out.size(), 1U);
+}
+
 namespace {
 class adl_class {};
 
@@ -143,6 +695,195 @@ TEST(Pformat, FormatWithADL) {
     ASSERT_EQ(f.format(c), "xasdfy");
 }
 
+namespace {
+// a log sequence number, placed as <file>/<offset> in hex
+struct lsn {
+    uint32_t file;
+    uint32_t offset;
+};
+
+struct page_ref {
+    std::string_view table;
+    uint32_t page;
+};
+}  // namespace
+
+template <>
+struct pformat::formatter<lsn> {
+    static constexpr size_t max_size = 8 + 1 + 8;
+
+    static char *place(char *buf, lsn const &v) noexcept {
+        buf = placement::internal::place_hex<true>(buf, v.file);
+        *buf++ = '/';
+        return placement::internal::place_hex<true>(buf, v.offset);
+    }
+};
+
+template <>
+struct pformat::formatter<page_ref> {
+    static size_t size(page_ref const &v) noexcept {
+        return v.table.size() + 1 + 10;
+    }
+
+    static char *place(char *buf, page_ref const &v) noexcept {
+        buf = placement::unsafe_place(buf, v.table);
+        *buf++ = ':';
+        return placement::unsafe_place(buf, v.page);
+    }
+};
+
+TEST(Pformat, FormatWithFormatter) {
+    using namespace pformat;
+
+    constexpr auto f = "lsn={} page={}"_fmt;
+    ASSERT_EQ(f.format(lsn{0x1a, 0x2b3c}, page_ref{"orders", 42}),
+              "lsn=1A/2B3C page=orders:42");
+    ASSERT_EQ(f.string_size_bound(lsn{}, page_ref{"orders", 42}),
+              4 + 17 + 6 + 6 + 1 + 10 + 1);
+
+    // max_size gives a static bound
+    static_assert(placement::static_placement_size<lsn>::value == 17);
+    static_assert(!placement::internal::has_static_placement_size<
+                  page_ref>::value);
+    static_assert("{}"_fmt.static_string_size_bound<lsn>() == 18);
+    ASSERT_EQ("{}"_fmt.format_fixed(lsn{1, 2}).view(), "1/2");
+
+    // specs, containers and captures work as for builtin types
+    ASSERT_EQ("{:>6}|"_fmt.format(lsn{1, 2}), "   1/2|");
+    ASSERT_EQ("{}"_fmt.format(std::vector<lsn>{{1, 2}, {3, 4}}),
+              "[1/2, 3/4]");
+    auto record = f.capture(lsn{5, 6}, page_ref{"t", 7});
+    ASSERT_EQ(render(record.data()), "lsn=5/6 page=t:7");
+}
+
+TEST(Pformat, CaptureAndRender) {
+    using namespace pformat;
+
+    constexpr auto f = "a {} b {} c {} d {} e {} f {} g {} h {} i {} j {}"_fmt;
+    std::string str{"string"};
+    std::string_view sv{"view"};
+    int8_t small = -5;
+    uint64_t large = std::numeric_limits<uint64_t>::max();
+    auto record = f.capture(small, large, 1.5, true, 'x', SOME_ENUM_B, str, sv,
+                            "c string", adl_class{});
+    ASSERT_EQ(record.size(),
+              f.capture_size(small, large, 1.5, true, 'x', SOME_ENUM_B, str,
+                             sv, "c string", adl_class{}));
+    str = "changed";
+
+    auto expected = f.format(small, large, 1.5, true, 'x', SOME_ENUM_B,
+                             "string", sv, "c string", adl_class{});
+    ASSERT_EQ(render(record.data()), expected);
+    ASSERT_LE(expected.size() + 1, binary::render_size_bound(record.data()));
+    ASSERT_EQ(binary::record_size(record.data()), record.size());
+
+    char buf[200];
+    char *end = render(record.data(), buf);
+    ASSERT_EQ(std::string_view(buf, end - buf), expected);
+}
+
+TEST(Pformat, CaptureStream) {
+    using namespace pformat;
+
+    // records of different sites can be stored back to back
+    std::vector<char> stream(1024);
+    char *p = stream.data();
+    p = "x{}y"_fmt.capture_to(p, 17);
+    p = "{} {}"_fmt.capture_to(p, any(p), shortest(0.1));
+    p = ""_fmt.capture_to(p);
+    p = "{:08x}|{:>6}|{:.2f}"_fmt.capture_to(p, 0xbeefU, "ab", 2.0 / 3);
+
+    char const *r = stream.data();
+    ASSERT_EQ(render(r), "x17y");
+    r += binary::record_size(r);
+    ASSERT_EQ(render(r).substr(0, 2), "0x");
+    ASSERT_EQ(render(r).substr(render(r).size() - 4), " 0.1");
+    r += binary::record_size(r);
+    ASSERT_EQ(render(r), "");
+    r += binary::record_size(r);
+    ASSERT_EQ(render(r), "0000beef|    ab|0.67");
+    r += binary::record_size(r);
+    ASSERT_EQ(r, p);
+
+    // capture_with asks for a buffer of capture_size bytes
+    constexpr auto f = "{} {}"_fmt;
+    size_t requested = 0;
+    char *end = f.capture_with(
+        [&](size_t size) {
+            requested = size;
+            return stream.data();
+        },
+        "with", 3);
+    ASSERT_EQ(requested, f.capture_size("with", 3));
+    ASSERT_EQ(end, stream.data() + binary::record_size(stream.data()));
+    ASSERT_EQ(render(stream.data()), "with 3");
+    ASSERT_EQ(f.capture_with([](size_t) -> char * { return nullptr; }, 1, 2),
+              nullptr);
+}
+
+TEST(Pformat, SiteRegistry) {
+    using namespace pformat;
+
+    // the site is registered during static initialization, before
+    // get_site below is executed
+    binary::site const *found = nullptr;
+    binary::for_each_site([&found](binary::site const &s) {
+        if (s.format == "registry {} test {}") {
+            found = &s;
+        }
+    });
+    ASSERT_NE(found, nullptr);
+
+    constexpr auto f = "registry {} test {}"_fmt;
+    ASSERT_EQ(f.format(17, "x"), "registry 17 test x");
+
+    auto const &site = f.get_site<int, char const *>();
+    ASSERT_EQ(found, &site);
+    ASSERT_EQ(binary::find_site(site.id), &site);
+    ASSERT_EQ(site.parameter_count, 2U);
+    ASSERT_EQ(site.arg_types[0], binary::arg_type::INT32);
+    ASSERT_EQ(site.arg_types[1], binary::arg_type::STRING);
+    ASSERT_EQ(site.static_size_bound, 0U);
+    ASSERT_EQ(site.segment_count, 4U);
+    ASSERT_FALSE(site.segments[0].is_parameter);
+    ASSERT_EQ(
+        site.literals.substr(site.segments[0].start, site.segments[0].size),
+        "registry ");
+    ASSERT_TRUE(site.segments[1].is_parameter);
+    ASSERT_EQ(site.segments[3].index, 1U);
+
+    // the id only depends on the format string and the argument types
+    static_assert(f.get_site_id<int, char const *>() ==
+                  f.get_site_id<int, std::string>());
+    ASSERT_EQ(site.id, (f.get_site_id<int, char const *>()));
+    ASSERT_NE(site.id, (f.get_site_id<int, int>()));
+    ASSERT_EQ((f.get_site<int, bool>().static_size_bound),
+              (f.static_string_size_bound<int, bool>()));
+
+    // plain format calls do not create sites
+    ASSERT_EQ("registry {} unused"_fmt.format(17), "registry 17 unused");
+    binary::for_each_site([](binary::site const &s) {
+        ASSERT_NE(s.format, "registry {} unused");
+    });
+
+    // the format specs are part of the segments
+    constexpr auto f2 = "registry {:08x}"_fmt;
+    auto const &site2 = f2.get_site<uint32_t>();
+    ASSERT_TRUE(site2.segments[1].is_parameter);
+    ASSERT_EQ(site2.segments[1].spec.type, 'x');
+    ASSERT_EQ(site2.segments[1].spec.width, 8U);
+    ASSERT_TRUE(site2.segments[1].spec.zero);
+    ASSERT_TRUE(site.segments[1].spec.is_default());
+
+    // escapes are resolved in the literals and adjacent literal text is
+    // merged into a single segment
+    constexpr auto f3 = "registry {{escaped}} {}"_fmt;
+    auto const &site3 = f3.get_site<int>();
+    ASSERT_EQ(site3.literals, "registry {escaped} ");
+    ASSERT_EQ(site3.segment_count, 2U);
+    ASSERT_EQ(site3.segments[0].size, site3.literals.size());
+}
+
 TEST(Pformat, FormatPointer) {
     using namespace pformat;
 
@@ -155,12 +896,251 @@ TEST(Pformat, FormatPointer) {
     ASSERT_EQ(s, compare_buf);
 }
 
-namespace {
-enum some_enum { SOME_ENUM_A, SOME_ENUM_B };
+TEST(Pformat, FormatPointerHexDigits) {
+    using namespace pformat;
 
-struct some_class {};
+    constexpr auto f = "{}"_fmt;
+    char compare_buf[30];
+    for (uintptr_t v : {uintptr_t{1}, uintptr_t{0xf}, uintptr_t{0x10},
+                        uintptr_t{0xabc}, uintptr_t{0x1234},
+                        std::numeric_limits<uintptr_t>::max()}) {
+        auto p = reinterpret_cast<char *>(v);
+        std::snprintf(compare_buf, 30, "%p", p);
+        ASSERT_EQ(f.format(any(p)), compare_buf);
+    }
+}
 
-}  // namespace
+TEST(Pformat, FormatHexdump) {
+    using namespace pformat;
+
+    std::vector<uint8_t> bytes(300);
+    std::mt19937 gen(7);
+    for (auto &b : bytes) {
+        b = static_cast<uint8_t>(gen());
+    }
+    constexpr auto f = "{}"_fmt;
+    char expected[4];
+    // all kernels and tails, from unaligned offsets
+    for (size_t group : {0, 1, 2, 3, 4, 5, 8, 15, 16, 17, 32, 64}) {
+        for (size_t offset = 0; offset < 3; ++offset) {
+            for (size_t size = 0; size < bytes.size() - offset;
+                 size += 1 + size / 8) {
+                std::string reference;
+                for (size_t i = 0; i < size; ++i) {
+                    if (group != 0 && i != 0 && i % group == 0) {
+                        reference += ' ';
+                    }
+                    std::snprintf(expected, 4, "%02x", bytes[offset + i]);
+                    reference += expected;
+                }
+                auto const h = hexdump(bytes.data() + offset, size, group);
+                ASSERT_EQ(f.format(h), reference)
+                    << "group " << group << " size " << size;
+                ASSERT_EQ(f.string_size_bound(h), reference.size() + 1);
+            }
+        }
+    }
+
+    ASSERT_EQ("page {:>10}|"_fmt.format(hexdump(std::string_view("\x01\xfe"))),
+              "page       01fe|");
+    std::array<std::byte, 4> const word{std::byte{0xde}, std::byte{0xad},
+                                        std::byte{0xbe}, std::byte{0xef}};
+    char buf[16];
+    f.format_to(buf, hexdump(word, 2));
+    ASSERT_STREQ(buf, "dead beef");
+}
+
+TEST(Pformat, FormatRange) {
+    using namespace pformat;
+
+    std::vector<int> const ids{17, -4, 1000000};
+    ASSERT_EQ("ids={}"_fmt.format(ids), "ids=[17, -4, 1000000]");
+    ASSERT_EQ("{}"_fmt.format(std::vector<int>{}), "[]");
+    ASSERT_EQ("{}"_fmt.format(std::vector<std::string>{"a", "", "bc"}),
+              "[a, , bc]");
+    ASSERT_EQ("{}"_fmt.format(std::vector<bool>{true, false}),
+              "[true, false]");
+    ASSERT_EQ("{}"_fmt.format(std::array<char, 2>{'x', 'y'}), "[x, y]");
+    ASSERT_EQ("{}"_fmt.format(std::make_pair(1, "one")), "(1, one)");
+    ASSERT_EQ("{}"_fmt.format(std::make_tuple(2.5, std::string("s"),
+                                              SOME_ENUM_B)),
+              "(2.500000, s, 1)");
+    ASSERT_EQ("{}"_fmt.format(std::tuple<>{}), "()");
+    std::vector<std::pair<int, std::vector<int>>> const nested{{1, {2, 3}},
+                                                               {4, {}}};
+    ASSERT_EQ("{}"_fmt.format(nested), "[(1, [2, 3]), (4, [])]");
+    // a spec applies to the whole range
+    ASSERT_EQ("{:>10}|"_fmt.format(std::vector<int>{1, 2}), "    [1, 2]|");
+
+    ASSERT_EQ("{}"_fmt.format(join(ids, "|")), "17|-4|1000000");
+    ASSERT_EQ("{}"_fmt.format(join(ids, " ; ", "{", "}")),
+              "{17 ; -4 ; 1000000}");
+    ASSERT_EQ("{}"_fmt.format(join(ids.data() + 1, 2)), "-4, 1000000");
+    ASSERT_EQ("{}"_fmt.format(join(ids.data(), 0, ",", "<", ">")), "<>");
+    std::set<std::string_view> const names{"b", "a"};
+    ASSERT_EQ("{}"_fmt.format(join(names)), "a, b");
+
+    // the bounds of ranges of static-size elements take no pass
+    constexpr auto f = "{}"_fmt;
+    ASSERT_EQ(f.string_size_bound(ids), 3 * 11 + 2 * 2 + 2 + 1);
+    static_assert(f.static_string_size_bound<std::array<int8_t, 2>>() ==
+                  2 * 4 + 2 + 2 + 1);
+    static_assert(
+        f.static_string_size_bound<std::pair<uint8_t, bool>>() ==
+        3 + 5 + 2 + 2 + 1);
+    static_assert(!placement::internal::is_placeable<
+                  std::vector<some_class>>());
+    static_assert(!placement::internal::is_placeable<
+                  std::tuple<int, some_class>>());
+
+    std::vector<uint64_t> many(1000);
+    std::iota(many.begin(), many.end(), 0);
+    std::string expected;
+    for (auto v : many) {
+        expected += (v == 0 ? "" : ",") + std::to_string(v);
+    }
+    memory_buffer buffer;
+    "{}"_fmt.format_append(buffer, join(many, ","));
+    ASSERT_EQ(std::string_view(buffer.data(), buffer.size()), expected);
+
+    // ranges are rendered when they are captured
+    char record[256];
+    "{} {}"_fmt.capture_to(record, ids, std::make_pair('a', 2));
+    ASSERT_EQ(render(record), "[17, -4, 1000000] (a, 2)");
+}
+
+TEST(Pformat, FormatStructured) {
+    using namespace pformat;
+
+    // names only label the parameters of the text output
+    constexpr auto f = "page {page_id} of \"{file}\" at {}: {ratio:.2f}"_fmt;
+    ASSERT_EQ(f.format(27, "a.db", 'x', 0.5), "page 27 of \"a.db\" at x: 0.50");
+
+    ASSERT_EQ(f.format_json(27, "a.db", 'x', 0.5),
+              R"({"msg":"page 27 of \"a.db\" at x: 0.50","page_id":27,)"
+              R"("file":"a.db","ratio":"0.50"})");
+    ASSERT_EQ(f.format_logfmt(27, "a.db", 'x', 0.5),
+              R"(msg="page 27 of \"a.db\" at x: 0.50" page_id=27 )"
+              R"(file="a.db" ratio=0.50)");
+
+    // strings are escaped in the message and in the fields
+    std::string const control = std::string("tab\tquote\"back\\") + '\x01';
+    ASSERT_EQ("{s}"_fmt.format_json(control),
+              R"({"msg":"tab\tquote\"back\\\u0001",)"
+              R"("s":"tab\tquote\"back\\\u0001"})");
+    ASSERT_EQ("{s:>6}"_fmt.format_logfmt("a\nb"),
+              R"(msg="   a\nb" s="   a\nb")");
+
+    // long strings pass the vector kernels, with and without escapes
+    for (size_t n : {15, 16, 31, 32, 33, 100}) {
+        std::string s(n, 'a');
+        ASSERT_EQ("{}"_fmt.format_json(s), R"({"msg":")" + s + R"("})");
+        s[n / 2] = '"';
+        s[n - 1] = '\n';
+        std::string escaped = s;
+        escaped.replace(n - 1, 1, "\\n");
+        escaped.replace(n / 2, 1, "\\\"");
+        ASSERT_EQ("{}"_fmt.format_json(s), R"({"msg":")" + escaped + R"("})");
+    }
+
+    // numbers and bools are raw, unless they are no JSON numbers
+    ASSERT_EQ("{a} {b} {c} {d}"_fmt.format_json(-1, true, SOME_ENUM_B, 1.5),
+              R"({"msg":"-1 true 1 1.500000","a":-1,"b":true,"c":1,)"
+              R"("d":1.500000})");
+    ASSERT_EQ("{a} {b:x}"_fmt.format_json(std::nan(""), 255),
+              R"({"msg":"nan ff","a":"nan","b":"ff"})");
+    ASSERT_EQ("{a} {b:x}"_fmt.format_logfmt(std::nan(""), 255),
+              R"(msg="nan ff" a=nan b=ff)");
+
+    std::string str = "> ";
+    "{id}"_fmt.format_json_append(str, 7);
+    ASSERT_EQ(str, R"(> {"msg":"7","id":7})");
+    memory_buffer buffer;
+    "{id}"_fmt.format_logfmt_append(buffer, std::string(600, 'x'));
+    ASSERT_EQ(std::string_view(buffer.data(), buffer.size()),
+              "msg=\"" + std::string(600, 'x') + "\" id=\"" +
+                  std::string(600, 'x') + "\"");
+}
+
+TEST(Pformat, FormatTimestamp) {
+    using namespace pformat;
+    using namespace std::chrono;
+
+    system_clock::time_point const t{seconds(1715933742) +
+                                     microseconds(123456)};
+    ASSERT_EQ("[{}]"_fmt.format(t), "[2024-05-17T08:15:42.123456Z]");
+    // the same second, minute and hour as the cached one
+    ASSERT_EQ("{}"_fmt.format(t + microseconds(7)),
+              "2024-05-17T08:15:42.123463Z");
+    ASSERT_EQ("{}"_fmt.format(t + seconds(17)), "2024-05-17T08:15:59.123456Z");
+    ASSERT_EQ("{}"_fmt.format(t + seconds(18)), "2024-05-17T08:16:00.123456Z");
+    ASSERT_EQ("{}"_fmt.format(t - seconds(1715933742)),
+              "1970-01-01T00:00:00.123456Z");
+    ASSERT_EQ("{}"_fmt.format(system_clock::time_point(microseconds(-1))),
+              "1969-12-31T23:59:59.999999Z");
+    // rounded down, not toward zero
+    ASSERT_EQ("{}"_fmt.format(
+                  system_clock::time_point(system_clock::duration(-1))),
+              "1969-12-31T23:59:59.999999Z");
+
+    timespec const ts{951782400, 999999999};
+    ASSERT_EQ("{:>30}"_fmt.format(ts), "   2000-02-29T00:00:00.999999Z");
+    // tv_nsec outside of [0, 10^9) is normalized
+    ASSERT_EQ("{}"_fmt.format(timespec{0, -1}), "1969-12-31T23:59:59.999999Z");
+    ASSERT_EQ("{}"_fmt.format(timespec{0, 2500000000}),
+              "1970-01-01T00:00:02.500000Z");
+    ASSERT_EQ("{}"_fmt.format(timespec{253402300799, 1000000000}),
+              "9999-12-31T23:59:59.000000Z");
+
+    // the size is fixed
+    static_assert("{} "_fmt.static_string_size_bound<timespec>() == 29);
+    auto const fixed = "{}"_fmt.format_fixed(t);
+    ASSERT_EQ(fixed.view(), "2024-05-17T08:15:42.123456Z");
+
+    // matches gmtime over the years 0 to 9999
+    std::mt19937_64 gen(3);
+    for (int i = 0; i < 1000; ++i) {
+        time_t const sec =
+            static_cast<time_t>(gen() % 315537897600) - 62167219200;
+        std::tm tm{};
+        gmtime_r(&sec, &tm);
+        timespec const v{sec, 42000};
+        ASSERT_EQ("{}"_fmt.format(v),
+                  "{:04}-{:02}-{:02}T{:02}:{:02}:{:02}.000042Z"_fmt.format(
+                      tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday,
+                      tm.tm_hour, tm.tm_min, tm.tm_sec))
+            << sec;
+    }
+
+    // time points without a four digit year are clamped
+    ASSERT_EQ("{}"_fmt.format(timespec{-62167219201, 0}),
+              "0000-01-01T00:00:00.000000Z");
+    ASSERT_EQ("{}"_fmt.format(timespec{253402300800, 0}),
+              "9999-12-31T23:59:59.000000Z");
+}
+
+TEST(Pformat, FormatConcat) {
+    using namespace pformat;
+
+    constexpr auto prefix = "[{}] {}:{} "_fmt;
+    constexpr auto f = prefix + "page {page_id:04x} {{flushed}}"_fmt;
+    ASSERT_EQ(f.format('W', "db.cc", 42, 27),
+              "[W] db.cc:42 page 001b {flushed}");
+    // the same site as the whole format string, " " and "page " are a
+    // single literal
+    constexpr auto whole = "[{}] {}:{} page {page_id:04x} {{flushed}}"_fmt;
+    auto const &site = f.get_site<char, char const *, int, int>();
+    ASSERT_EQ(site.id, (whole.get_site_id<char, char const *, int, int>()));
+    ASSERT_EQ(site.format, "[{}] {}:{} page {page_id:04x} {{flushed}}");
+    ASSERT_EQ(site.segment_count, 9);
+    ASSERT_EQ(f.format_json('W', "db.cc", 42, 27),
+              R"({"msg":"[W] db.cc:42 page 001b {flushed}",)"
+              R"("page_id":"001b"})");
+
+    constexpr auto g = concat("{}"_fmt, ""_fmt, "-"_fmt, "{}"_fmt);
+    static_assert(g.static_string_size_bound<bool, bool>() == 12);
+    ASSERT_EQ(g.format(true, false), "true-false");
+}
 
 TEST(Pformat, FormatEnum) {
     using namespace pformat;
@@ -0,0 +1,108 @@
+// Built as its own executable: PFORMAT_ENABLE_STATS changes the layout of
+// the format sites, so it has to be defined in all translation units.
+#ifndef PFORMAT_ENABLE_STATS
+#define PFORMAT_ENABLE_STATS
+#endif
+
+#include <gtest/gtest.h>
+#include <pformat/pformat.h>
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace {
+// the summary of the site with the format string
+pformat::stats::site_summary find_site(std::string_view format) {
+    for (auto const &s : pformat::stats::collect_stats()) {
+        if (s.site->format == format) {
+            return s;
+        }
+    }
+    return {};
+}
+}  // namespace
+
+TEST(Stats, CountsCalls) {
+    using namespace pformat;
+    static_assert(stats::enabled);
+    size_t bytes = 0;
+    for (int i = 0; i < 130; ++i) {
+        bytes += "stats a={} b={}"_fmt.format(i, "x").size();
+    }
+    auto const s = find_site("stats a={} b={}");
+    ASSERT_NE(s.site, nullptr);
+    EXPECT_EQ(s.calls, 130);
+    EXPECT_EQ(s.bytes, bytes);
+    EXPECT_EQ(s.measured_calls, 130);
+    // the first and every PFORMAT_STATS_SAMPLE_INTERVAL-th call
+    EXPECT_EQ(s.samples, 3);
+    uint64_t histogram_samples = 0;
+    for (auto count : s.histogram) {
+        histogram_samples += count;
+    }
+    EXPECT_EQ(histogram_samples, s.samples);
+    EXPECT_LE(s.percentile_cycles(0.5), s.percentile_cycles(0.99));
+}
+
+TEST(Stats, FormatToDoesNotMeasure) {
+    using namespace pformat;
+    char buf[64];
+    "stats format_to {}"_fmt.format_to(buf, 12345);
+    "stats format_to {}"_fmt.format_to(buf, 1);
+    auto const s = find_site("stats format_to {}");
+    EXPECT_EQ(s.calls, 2);
+    EXPECT_EQ(s.bytes, 2 * 16 + 5 + 1);
+    EXPECT_EQ(s.measured_calls, 0);
+}
+
+TEST(Stats, SumsThreads) {
+    using namespace pformat;
+    auto work = [] {
+        std::string s;
+        for (int i = 0; i < 100; ++i) {
+            "stats thread {}"_fmt.format_append(s, i);
+        }
+    };
+    std::thread a(work);
+    std::thread b(work);
+    a.join();
+    b.join();
+    work();
+    EXPECT_EQ(find_site("stats thread {}").calls, 300);
+}
+
+TEST(Stats, DumpRanksSites) {
+    using namespace pformat;
+    for (int i = 0; i < 64; ++i) {
+        "stats dump {}"_fmt.format(std::string(1000, 'x'));
+    }
+    std::ostringstream out;
+    dump_stats(out, 100);
+    std::string const dump = out.str();
+    EXPECT_EQ(dump.find("cycles%"), 0);
+    EXPECT_NE(dump.find("stats dump {}"), std::string::npos);
+    EXPECT_NE(dump.find("stats a={} b={}"), std::string::npos);
+
+    std::ostringstream limited;
+    dump_stats(limited, 1);
+    // the header and one site
+    std::string const first = limited.str();
+    EXPECT_EQ(std::count(first.begin(), first.end(), '\n'), 2);
+
+    // the caller's stream state is kept
+    limited << 2.0 / 3;
+    EXPECT_EQ(limited.str().substr(first.size()), "0.666667");
+}
+
+TEST(Stats, IgnoresSitesPastTheLimit) {
+    using pformat::stats::internal::thread_shard;
+    thread_shard shard;
+    constexpr size_t limit =
+        thread_shard::block_size * thread_shard::max_blocks;
+    EXPECT_NE(shard.counters(limit - 1), nullptr);
+    EXPECT_EQ(shard.counters(limit), nullptr);
+    EXPECT_EQ(shard.find(limit), nullptr);
+}
@@ -0,0 +1,216 @@
+// Renders a binary pformat log (see pformat/binary_log.h) as text.
+//
+// usage: pformat_decode [-j threads] input [output]
+//
+// The input is mapped into memory. Blocks are decoded in parallel and
+// written in file order, so the output is identical to a single-threaded
+// decode.
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "pformat/binary_log.h"
+
+namespace {
+
+struct block_ref {
+    char const *data;
+    size_t size;
+};
+
+struct decoded_block {
+    std::string text;
+    bool ready = false;
+    bool ok = false;
+};
+
+int usage() {
+    std::fprintf(stderr, "usage: pformat_decode [-j threads] input [output]\n");
+    return 2;
+}
+
+bool write_all(int fd, char const *data, size_t size) {
+    while (size > 0) {
+        ssize_t const written = ::write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        size -= written;
+    }
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    int arg = 1;
+    if (arg < argc && std::strncmp(argv[arg], "-j", 2) == 0) {
+        // -j N or -jN
+        char const *value = argv[arg][2] != 0 ? argv[arg] + 2 : argv[++arg];
+        if (value == nullptr) {
+            return usage();
+        }
+        threads = std::max(1, std::atoi(value));
+        arg++;
+    }
+    if (arg >= argc || argc - arg > 2) {
+        return usage();
+    }
+    char const *input_path = argv[arg];
+    char const *output_path = arg + 1 < argc ? argv[arg + 1] : nullptr;
+
+    int const in = ::open(input_path, O_RDONLY);
+    struct stat st;
+    if (in < 0 || ::fstat(in, &st) != 0) {
+        std::perror(input_path);
+        return 1;
+    }
+    size_t const file_size = st.st_size;
+    if (file_size < sizeof(pformat::binary::file_magic)) {
+        std::fprintf(stderr, "%s: not a pformat log\n", input_path);
+        return 1;
+    }
+    void *mapped = ::mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, in, 0);
+    if (mapped == MAP_FAILED) {
+        std::perror(input_path);
+        return 1;
+    }
+    ::madvise(mapped, file_size, MADV_SEQUENTIAL);
+    char const *file = static_cast<char const *>(mapped);
+    if (std::memcmp(file, pformat::binary::file_magic,
+                    sizeof(pformat::binary::file_magic)) != 0) {
+        std::fprintf(stderr, "%s: not a pformat log\n", input_path);
+        return 1;
+    }
+
+    int const out = output_path == nullptr
+                        ? STDOUT_FILENO
+                        : ::open(output_path, O_WRONLY | O_CREAT | O_TRUNC,
+                                 0644);
+    if (out < 0) {
+        std::perror(output_path);
+        return 1;
+    }
+
+    // the block headers are read sequentially, the dictionaries are small
+    pformat::binary::decoder decoder;
+    std::vector<block_ref> blocks;
+    size_t offset = sizeof(pformat::binary::file_magic);
+    while (offset < file_size) {
+        pformat::binary::block_header header;
+        if (file_size - offset < sizeof(header)) {
+            std::fprintf(stderr, "%s: truncated block at %zu\n", input_path,
+                         offset);
+            return 1;
+        }
+        std::memcpy(&header, file + offset, sizeof(header));
+        offset += sizeof(header);
+        if (header.magic != pformat::binary::block_magic ||
+            header.size > file_size - offset) {
+            std::fprintf(stderr, "%s: corrupt block at %zu\n", input_path,
+                         offset - sizeof(header));
+            return 1;
+        }
+        if (header.type == pformat::binary::block_type::DICTIONARY) {
+            if (!decoder.add_dictionary(file + offset, header.size)) {
+                std::fprintf(stderr, "%s: corrupt dictionary at %zu\n",
+                             input_path, offset - sizeof(header));
+                return 1;
+            }
+        } else if (header.type == pformat::binary::block_type::RECORDS) {
+            blocks.push_back({file + offset, size_t(header.size)});
+        }
+        offset += header.size;
+    }
+
+    // workers decode blocks in file order into a bounded window of output
+    // buffers, the main thread writes the window in order
+    size_t const window = 4 * threads;
+    std::vector<decoded_block> decoded(blocks.size());
+    std::atomic<size_t> next_block{0};
+    std::mutex mutex;
+    std::condition_variable ready_cv;
+    std::condition_variable space_cv;
+    size_t written_blocks = 0;  // protected by mutex
+
+    auto worker = [&]() {
+        for (;;) {
+            size_t const i = next_block.fetch_add(1);
+            if (i >= blocks.size()) {
+                return;
+            }
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                space_cv.wait(lock, [&]() { return i < written_blocks + window; });
+            }
+            std::string text;
+            text.reserve(blocks[i].size * 2);
+            bool const ok =
+                decoder.render_block(blocks[i].data, blocks[i].size, text);
+            std::lock_guard<std::mutex> lock(mutex);
+            decoded[i].text = std::move(text);
+            decoded[i].ok = ok;
+            decoded[i].ready = true;
+            ready_cv.notify_all();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < std::min<size_t>(threads, blocks.size()); ++t) {
+        workers.emplace_back(worker);
+    }
+
+    int result = 0;
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        std::string text;
+        bool ok;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            ready_cv.wait(lock, [&]() { return decoded[i].ready; });
+            text = std::move(decoded[i].text);
+            ok = decoded[i].ok;
+        }
+        if (result == 0 && !write_all(out, text.data(), text.size())) {
+            std::perror(output_path ? output_path : "stdout");
+            result = 1;
+        }
+        if (result == 0 && !ok) {
+            std::fprintf(stderr, "%s: corrupt records in block %zu\n",
+                         input_path, i);
+            result = 1;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        written_blocks = i + 1;
+        space_cv.notify_all();
+    }
+    for (auto &w : workers) {
+        w.join();
+    }
+
+    ::munmap(mapped, file_size);
+    ::close(in);
+    if (output_path != nullptr && ::close(out) != 0) {
+        std::perror(output_path);
+        return 1;
+    }
+    return result;
+}